@@ -0,0 +1,145 @@
+/*
+ *  getstate.cpp: cost of reading a task's state at dispatch
+ *
+ *  Compares the previous fopen + getline scan of /proc/<pid>/task/<pid>/
+ *  status, a pread of /proc/<pid>/stat on an fd kept open (the fallback of
+ *  task::get_proc_state), and the state tracked from wait4 (task::
+ *  get_state for a stopped task). Each is timed alone on a stopped child,
+ *  and as part of a dispatch: read the state, SIGCONT, SIGSTOP and wait4
+ *  for the stop, which is what a scheduler does per slice without the
+ *  slice itself.
+ *
+ *  Usage: ./bin/bench_getstate [iterations]
+ */
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <err.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include "../include/types.hpp"
+
+static pid_t child;
+static int statfd = -1;
+static char tracked = 'T';
+
+static char
+status_state() noexcept
+{
+    char buf[64];
+    snprintf(buf, sizeof(buf), "/proc/%d/task/%d/status", child, child);
+    FILE *f = fopen(buf, "r");
+    if (!f)
+        err(EXIT_FAILURE, "fopen");
+    char *line = nullptr;
+    size_t sz = 0;
+    char state = 'I';
+    while (getline(&line, &sz, f) > 0)
+        if (!strncmp(line, "State:", strlen("State:")))
+            sscanf(line, "%*s %c", &state);
+    free(line);
+    fclose(f);
+    return state;
+}
+
+static char
+stat_state() noexcept
+{
+    char buf[256];
+    ssize_t n = pread(statfd, buf, sizeof(buf) - 1, 0);
+    if (n <= 0)
+        err(EXIT_FAILURE, "pread");
+    buf[n] = '\0';
+    const char *p = strrchr(buf, ')');
+    return p ? p[2] : 'I';
+}
+
+static char
+tracked_state() noexcept
+{
+    return tracked;
+}
+
+/* state reads per second on the stopped child */
+static double
+probe(char (*fn)(), u64 n)
+{
+    u64 sink = 0;
+    auto t0 = steady_clock::now();
+    for (u64 i = 0; i < n; ++i)
+        sink += fn();
+    auto t1 = steady_clock::now();
+    asm volatile("" :: "r"(sink));
+    return n / duration<double>(t1 - t0).count();
+}
+
+/* state read + resume + stop + wait4 cycles per second */
+static double
+dispatch(char (*fn)(), u64 n)
+{
+    u64 sink = 0;
+    int wstat;
+    auto t0 = steady_clock::now();
+    for (u64 i = 0; i < n; ++i) {
+        sink += fn();
+        kill(child, SIGCONT);
+        tracked = 'R';
+        kill(child, SIGSTOP);
+        if (waitpid(child, &wstat, WUNTRACED) < 0 || !WIFSTOPPED(wstat))
+            err(EXIT_FAILURE, "waitpid");
+        tracked = 'T';
+    }
+    auto t1 = steady_clock::now();
+    asm volatile("" :: "r"(sink));
+    return n / duration<double>(t1 - t0).count();
+}
+
+int
+main(int argc, char *argv[])
+{
+    u64 n = (argc > 1) ? std::stoull(argv[1]) : 20000;
+
+    if ((child = fork()) < 0)
+        err(EXIT_FAILURE, "fork");
+    if (child == 0)
+        for (;;)
+            ;
+    kill(child, SIGSTOP);
+    int wstat;
+    waitpid(child, &wstat, WUNTRACED);
+
+    char path[32];
+    snprintf(path, sizeof(path), "/proc/%d/stat", child);
+    if ((statfd = open(path, O_RDONLY | O_CLOEXEC)) < 0)
+        err(EXIT_FAILURE, "open");
+
+    struct {
+        const char  *name;
+        char        (*fn)();
+    } methods[] = {
+        { "status scan", status_state },
+        { "stat pread", stat_state },
+        { "tracked", tracked_state }
+    };
+
+    std::cout << std::left << std::setw(14) << "method"
+              << std::setw(18) << "reads/s"
+              << "dispatches/s\n";
+    for (auto &m : methods) {
+        double r = probe(m.fn, n * 10);
+        double d = dispatch(m.fn, n);
+        std::cout << std::left << std::setw(14) << m.name
+                  << std::setw(18) << std::fixed << std::setprecision(0) << r
+                  << d << '\n';
+    }
+
+    kill(child, SIGKILL);
+    waitpid(child, &wstat, 0);
+    exit(0);
+}
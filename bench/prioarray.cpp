@@ -0,0 +1,107 @@
+/*
+ *  prioarray.cpp: pick-next cost of the mlfq priority array
+ *
+ *  Compares the previous linear scan over an array of FIFO levels against
+ *  prio_array's find-first-set over a bitmap of non-empty levels, at 4, 64
+ *  and 140 levels. All tasks sit on the bottom level and are requeued
+ *  there after each pick, as happens to cpu bound tasks between boosts,
+ *  so the scan walks every empty level on every dispatch.
+ *
+ *  Usage: ./bin/bench_prioarray [picks per size]
+ */
+#include <iostream>
+#include <iomanip>
+#include <array>
+#include <deque>
+#include <string>
+#include <cstdlib>
+#include "../include/types.hpp"
+#include "../include/mlfq.hpp"
+
+template<u32 N>
+struct scan_levels {
+    std::array<std::deque<u32>, N>  levels;
+
+    scan_levels(u32 n)
+    {
+        for (u32 i = 0; i < n; ++i)
+            levels[N - 1].push_back(i);
+    }
+
+    u64
+    step() noexcept
+    {
+        for (u32 lvl = 0; lvl < N; ++lvl) {
+            if (levels[lvl].empty())
+                continue;
+            u32 id = levels[lvl].front();
+            levels[lvl].pop_front();
+            levels[lvl].push_back(id);
+            return id;
+        }
+        return 0;
+    }
+};
+
+template<u32 N>
+struct bitmap_levels {
+    prio_array<u32, N>  levels;
+
+    bitmap_levels(u32 n)
+    {
+        for (u32 i = 0; i < n; ++i)
+            levels.push(i, N - 1);
+    }
+
+    u64
+    step() noexcept
+    {
+        u32 id = 0, lvl = N - 1;
+        levels.pop(&id, &lvl);
+        levels.push(id, lvl);
+        return id;
+    }
+};
+
+/* returns pick + requeue operations per second */
+template<typename Q>
+double
+bench(u32 ntasks, u64 picks)
+{
+    Q q(ntasks);
+    u64 sink = 0;
+    auto t0 = high_resolution_clock::now();
+    for (u64 i = 0; i < picks; ++i)
+        sink += q.step();
+    auto t1 = high_resolution_clock::now();
+    asm volatile("" :: "r"(sink));
+    double secs = duration_cast<nanoseconds>(t1 - t0).count() / 1e9;
+    return picks / secs;
+}
+
+template<u32 N>
+void
+row(u64 picks)
+{
+    double s = bench<scan_levels<N>>(1024, picks);
+    double b = bench<bitmap_levels<N>>(1024, picks);
+    std::cout << std::left << std::setw(10) << N
+              << std::setw(20) << std::fixed << std::setprecision(0) << s
+              << std::setw(20) << b
+              << std::setprecision(2) << b / s << "x\n";
+}
+
+int
+main(int argc, char *argv[])
+{
+    u64 picks = (argc > 1) ? std::stoull(argv[1]) : 20000000;
+
+    std::cout << std::left << std::setw(10) << "levels"
+              << std::setw(20) << "scan picks/s"
+              << std::setw(20) << "bitmap picks/s"
+              << "speedup\n";
+    row<4>(picks);
+    row<64>(picks);
+    row<140>(picks);
+    exit(0);
+}
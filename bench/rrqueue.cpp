@@ -0,0 +1,119 @@
+/*
+ *  rrqueue.cpp: enqueue/dequeue throughput of the round robin ready queue
+ *
+ *  Compares the previous binary semaphore guarded std::queue against the
+ *  lock-free mpmc_queue at 1..64 threads. Every thread alternates one
+ *  enqueue and one dequeue, so the queue stays shallow and each operation
+ *  contends on the ends of the queue, as rr workers do when requeueing.
+ *
+ *  Usage: ./bin/bench_rrqueue [ops per thread]
+ */
+#include <iostream>
+#include <iomanip>
+#include <queue>
+#include <vector>
+#include <thread>
+#include <semaphore>
+#include <atomic>
+#include <string>
+#include <cstdlib>
+#include "../include/types.hpp"
+#include "../include/mpmc.hpp"
+
+struct sem_queue {
+    std::queue<u64>         q;
+    std::binary_semaphore   sem{1};
+
+    void
+    push(u64 v) noexcept
+    {
+        sem.acquire();
+        q.push(v);
+        sem.release();
+    }
+
+    bool
+    pop(u64 &v) noexcept
+    {
+        sem.acquire();
+        if (q.empty()) {
+            sem.release();
+            return false;
+        }
+        v = q.front();
+        q.pop();
+        sem.release();
+        return true;
+    }
+};
+
+struct ring_queue {
+    mpmc_queue<u64, 4096>   q;
+
+    void
+    push(u64 v) noexcept
+    {
+        while (!q.try_push(v))
+            std::this_thread::yield();
+    }
+
+    bool
+    pop(u64 &v) noexcept
+    {
+        return q.try_pop(v);
+    }
+};
+
+/* returns enqueue + dequeue operations per second */
+template<typename Q>
+double
+bench(u32 nthreads, u64 ops)
+{
+    Q q;
+    std::atomic<u32> ready(0);
+    std::atomic<bool> go(false);
+    std::vector<std::thread> threads;
+    threads.reserve(nthreads);
+    for (u32 i = 0; i < nthreads; ++i) {
+        threads.emplace_back([&]{
+            ready.fetch_add(1);
+            while (!go.load())
+                ;
+            u64 v;
+            for (u64 n = 0; n < ops; ++n) {
+                q.push(n);
+                while (!q.pop(v))
+                    ;
+            }
+        });
+    }
+    while (ready.load() != nthreads)
+        ;
+    auto t0 = high_resolution_clock::now();
+    go.store(true);
+    for (std::thread &th : threads)
+        th.join();
+    auto t1 = high_resolution_clock::now();
+    double secs = duration_cast<nanoseconds>(t1 - t0).count() / 1e9;
+    return (2.0 * ops * nthreads) / secs;
+}
+
+int
+main(int argc, char *argv[])
+{
+    u64 ops = (argc > 1) ? std::stoull(argv[1]) : 200000;
+
+    std::cout << std::left << std::setw(10) << "threads"
+              << std::setw(20) << "semaphore ops/s"
+              << std::setw(20) << "mpmc ops/s"
+              << "speedup\n";
+    for (u32 n = 1; n <= 64; n *= 2) {
+        double s = bench<sem_queue>(n, ops);
+        double r = bench<ring_queue>(n, ops);
+        std::cout << std::left << std::setw(10) << n
+                  << std::setw(20) << std::fixed << std::setprecision(0) << s
+                  << std::setw(20) << r
+                  << std::setprecision(2) << r / s << "x\n";
+    }
+    exit(0);
+}
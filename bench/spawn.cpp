@@ -0,0 +1,63 @@
+/*
+ *  spawn.cpp: task launch throughput and latency per launch method
+ *
+ *  Every launch asks for an exec'd, stopped ./bin/cpu_task (with zero
+ *  iterations), which is what a scheduler needs before it can hand out a
+ *  slice. Only the launch itself is timed; the child is then continued and
+ *  reaped outside the measurement. Run from the repository root.
+ *
+ *  Usage: ./bin/bench_spawn [launches per method]
+ */
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <cstdlib>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include "../include/types.hpp"
+#include "../include/histogram.hpp"
+#include "../include/launcher.hpp"
+
+int
+main(int argc, char *argv[])
+{
+    u32 n = (argc > 1) ? std::stoul(argv[1]) : 2000;
+    static char *const args[] = {
+        (char *)"./bin/cpu_task", (char *)"0", nullptr
+    };
+    const launch_method methods[] = {
+        launch_method::FORK, launch_method::SPAWN,
+        launch_method::VFORK, launch_method::ZYGOTE
+    };
+
+    std::cout << std::left << std::setw(14) << "method"
+              << std::setw(16) << "launches/s"
+              << std::setw(12) << "p50 (us)"
+              << std::setw(12) << "p99 (us)"
+              << "max (us)\n";
+    for (launch_method m : methods) {
+        launcher::init(m);
+        histogram h;
+        u64 t_total = 0;
+        for (u32 i = 0; i < n; ++i) {
+            auto t0 = steady_clock::now();
+            pid_t pid = launcher::spawn(args[0], args, true);
+            auto t1 = steady_clock::now();
+            u64 ns = duration_cast<nanoseconds>(t1 - t0).count();
+            h.record(ns);
+            t_total += ns;
+
+            kill(pid, SIGCONT);
+            waitpid(pid, nullptr, 0);
+        }
+        std::cout << std::left << std::setw(14) << launcher::name(m)
+                  << std::setw(16) << std::fixed << std::setprecision(0)
+                  << n / (t_total / 1e9)
+                  << std::setprecision(1)
+                  << std::setw(12) << h.percentile(50) / 1e3
+                  << std::setw(12) << h.percentile(99) / 1e3
+                  << h.max() / 1e3 << '\n';
+    }
+    exit(0);
+}
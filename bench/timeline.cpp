@@ -0,0 +1,118 @@
+/*
+ *  timeline.cpp: pick-next cost of the cfs timeline against mlfq levels
+ *
+ *  Keeps N tasks runnable and repeatedly picks the next one and requeues
+ *  it, as a worker does once per slice. The cfs timeline is the intrusive
+ *  red-black tree keyed on vruntime (O(log n) requeue, O(1) pick through
+ *  the cached leftmost node); mlfq is an array of four FIFO levels
+ *  scanned from the top.
+ *
+ *  Usage: ./bin/bench_timeline [picks per size]
+ */
+#include <iostream>
+#include <iomanip>
+#include <array>
+#include <queue>
+#include <vector>
+#include <string>
+#include <random>
+#include <cstdlib>
+#include "../include/types.hpp"
+#include "../include/task.hpp"
+#include "../include/rbtree.hpp"
+
+struct cfs_timeline {
+    std::vector<sched_entity>   se;
+    rb_tree                     tree;
+    std::mt19937_64             rng{1};
+
+    static bool
+    less(const rb_node *a, const rb_node *b) noexcept
+    {
+        return rb_entry(a, sched_entity, run_node)->vruntime <
+               rb_entry(b, sched_entity, run_node)->vruntime;
+    }
+
+    cfs_timeline(u32 n) : se(n)
+    {
+        for (sched_entity &s : se) {
+            s.vruntime = rng() % 1000000;
+            s.weight = NICE_0_WEIGHT;
+            tree.insert(&s.run_node, less);
+        }
+    }
+
+    /* run the leftmost task for a slice of 1-6 ms and requeue it */
+    u64
+    step() noexcept
+    {
+        rb_node *n = tree.first();
+        tree.erase(n);
+        sched_entity *s = rb_entry(n, sched_entity, run_node);
+        s->vruntime += 1000000 + rng() % 5000000;
+        tree.insert(n, less);
+        return s->vruntime;
+    }
+};
+
+struct mlfq_levels {
+    std::array<std::queue<u32>, 4>  levels;
+    std::mt19937_64                 rng{1};
+
+    mlfq_levels(u32 n)
+    {
+        for (u32 i = 0; i < n; ++i)
+            levels[rng() % levels.size()].push(i);
+    }
+
+    /* dispatch from the highest non-empty level and demote */
+    u64
+    step() noexcept
+    {
+        for (u32 lvl = 0; lvl < levels.size(); ++lvl) {
+            if (levels[lvl].empty())
+                continue;
+            u32 id = levels[lvl].front();
+            levels[lvl].pop();
+            levels[std::min<u32>(lvl + 1, levels.size() - 1)].push(id);
+            return id;
+        }
+        return 0;
+    }
+};
+
+/* returns pick + requeue operations per second */
+template<typename Q>
+double
+bench(u32 ntasks, u64 picks)
+{
+    Q q(ntasks);
+    u64 sink = 0;
+    auto t0 = high_resolution_clock::now();
+    for (u64 i = 0; i < picks; ++i)
+        sink += q.step();
+    auto t1 = high_resolution_clock::now();
+    asm volatile("" :: "r"(sink));
+    double secs = duration_cast<nanoseconds>(t1 - t0).count() / 1e9;
+    return picks / secs;
+}
+
+int
+main(int argc, char *argv[])
+{
+    u64 picks = (argc > 1) ? std::stoull(argv[1]) : 2000000;
+
+    std::cout << std::left << std::setw(10) << "tasks"
+              << std::setw(20) << "cfs picks/s"
+              << std::setw(20) << "mlfq picks/s"
+              << "ratio\n";
+    for (u32 n = 16; n <= 65536; n *= 4) {
+        double c = bench<cfs_timeline>(n, picks);
+        double m = bench<mlfq_levels>(n, picks);
+        std::cout << std::left << std::setw(10) << n
+                  << std::setw(20) << std::fixed << std::setprecision(0) << c
+                  << std::setw(20) << m
+                  << std::setprecision(2) << c / m << "x\n";
+    }
+    exit(0);
+}
@@ -0,0 +1,54 @@
+/*
+ *  trace.cpp: cost of recording a scheduler event
+ *
+ *  Times trace::emit with tracing disabled at run time (a relaxed load and
+ *  a branch), enabled on one thread, and enabled on several threads at
+ *  once, each into its own ring. A slice records two or three events
+ *  (dispatch, preempt or exit, maybe demote), against a dispatch that
+ *  costs microseconds (see bench_getstate) and a slice of milliseconds.
+ *
+ *  Usage: ./bin/bench_trace [events per thread]
+ */
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdlib>
+#include "../include/types.hpp"
+#include "../include/trace.hpp"
+
+/* ns per event with nthreads emitting n events each */
+static double
+bench(u32 nthreads, u64 n)
+{
+    auto t0 = steady_clock::now();
+    std::vector<std::thread> threads;
+    for (u32 i = 0; i < nthreads; ++i)
+        threads.emplace_back([n, i]{
+            for (u64 j = 0; j < n; ++j)
+                trace::emit(trace_type::DISPATCH, i, j);
+        });
+    for (std::thread &th : threads)
+        th.join();
+    auto t1 = steady_clock::now();
+    return duration<double, std::nano>(t1 - t0).count() / n;
+}
+
+int
+main(int argc, char *argv[])
+{
+    u64 n = (argc > 1) ? std::stoull(argv[1]) : 10000000;
+    u32 ncpus = std::max(2u, std::thread::hardware_concurrency());
+
+    std::cout << std::left << std::setw(24) << "mode" << "ns/event\n";
+    std::cout << std::setw(24) << "disabled" << std::fixed
+              << std::setprecision(2) << bench(1, n) << '\n';
+    trace::set_path("/dev/null");
+    std::cout << std::setw(24) << "enabled, 1 thread"
+              << bench(1, n) << '\n';
+    std::cout << std::setw(24)
+              << ("enabled, " + std::to_string(ncpus) + " threads")
+              << bench(ncpus, n) << '\n';
+    exit(0);
+}
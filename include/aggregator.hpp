@@ -0,0 +1,66 @@
+#ifndef SCHEDSIM_AGGREGATOR_H
+#define SCHEDSIM_AGGREGATOR_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "types.hpp"
+#include "task.hpp"
+#include "metrics.hpp"
+
+#define AGG_INTERVAL_S  1   // default seconds between snapshots
+#define AGG_WINDOWS     4   // fairness window slots, indexed by epoch
+
+/*
+ *  Online metrics of a live run. A scheduler hands each task to retire()
+ *  once it has exited and nothing refers to it any longer; the task is
+ *  folded into the running totals and its table slot freed at once, so
+ *  memory is bounded by the tasks in flight however long the run. While
+ *  the simulation runs, a reporter thread prints a snapshot of every
+ *  interval: tasks finished per second, the share of the cpus the tasks
+ *  were accounted, the tasks alive, and the fairness of the interval.
+ *
+ *  The windowed fairness is Jain's index of the cpu time each task alive
+ *  in the interval received in it, those that got none included. Tasks
+ *  charge their cpu time to the current window as it is accounted, and
+ *  keep the sum and sum of squares current by adding (a + d)^2 - a^2 for
+ *  d more us on top of a, so the index needs no pass over the tasks.
+ *
+ *  The windows tumble rather than slide, one per interval: a sliding
+ *  window would have to drop each task's oldest cpu time from its square
+ *  as the window moves, which takes a pass over the tasks. The series
+ *  still shows how fast a scheduler converges after a burst, at the
+ *  resolution of the interval. Each epoch charges its own slot of a ring
+ *  of AGG_WINDOWS; the reporter advances the epoch and reads the window
+ *  closed an interval earlier, so a charge that loaded its epoch just
+ *  before a rollover still lands in a window not yet read or cleared.
+ */
+class aggregator {
+private:
+    static metrics                  totals;
+    static std::atomic<u64>         nr_retired;
+    static u32                      interval;   // seconds, 0: no snapshots
+    static time_point<steady_clock> t_start;
+    static std::mutex               mtx;        // lock for totals and stop
+    static std::condition_variable  cv;
+    static std::thread              reporter;
+    static bool                     stop;
+    static std::atomic<u64>         epoch;      // current window
+    static std::atomic<double>      win_sum[AGG_WINDOWS];   // us
+    static std::atomic<double>      win_sum_sq[AGG_WINDOWS];
+
+    static void report() noexcept;
+public:
+    static void set_interval(u32 secs) noexcept;
+    /* begin a run: reset the totals and start the reporter */
+    static void start() noexcept;
+    /* charge d of cpu time to the current window of the task with s */
+    static void charge(task_stat &s, nanoseconds d) noexcept;
+    /* fold a finished task into the totals and destroy it */
+    static void retire(task *t) noexcept;
+    /* stop the reporter and return the metrics of the run */
+    static metrics finish() noexcept;
+};
+#endif
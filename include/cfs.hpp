@@ -0,0 +1,78 @@
+#ifndef SCHEDSIM_CFS_H
+#define SCHEDSIM_CFS_H
+
+#include <iostream>
+#include <atomic>
+#include <type_traits>
+#include <sys/resource.h>
+#include <sys/sysinfo.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include "types.hpp"
+#include "task.hpp"
+#include "tasktable.hpp"
+#include "rbtree.hpp"
+#include "percpu.hpp"
+
+#define CFS_LATENCY_NS      48000000    // period every runnable task runs in
+#define CFS_MIN_GRAN_NS     6000000     // shortest slice handed out
+#define CFS_NR_LATENCY      (CFS_LATENCY_NS / CFS_MIN_GRAN_NS)
+#define CFS_IDLE_WAIT_US    10000       // idle worker retries pulls every 10 ms
+
+namespace scheduler {
+struct cfs_rq : percpu_rq {
+    rb_tree                 timeline;       // queued tasks by vruntime
+    u64                     load;           // sum of queued weights
+    u64                     min_vruntime;   // monotonic timeline floor
+    u64                     nr_pulls;       // tasks pulled from others
+    u64                     nr_peak;        // most tasks queued at once
+};
+
+/*
+ *  Completely Fair Scheduler: every pinned worker keeps a timeline of its
+ *  queued tasks ordered by vruntime, the cpu time a task received scaled
+ *  by NICE_0_WEIGHT / weight, and always runs the leftmost task. The period
+ *  CFS_LATENCY_NS is split between runnable tasks in proportion to their
+ *  weight, and is stretched once every task would get less than
+ *  CFS_MIN_GRAN_NS. Idle workers pull the leftmost task of the busiest cpu.
+ */
+class cfs : public percpu<cfs, cfs_rq> {
+private:
+    friend class percpu<cfs, cfs_rq>;
+    using runqueue = cfs_rq;
+
+    i32                     mem_nice;       // nice of every mem_task
+
+    void insert(runqueue &rq, sched_entity *se) noexcept;
+    sched_entity *pick(runqueue &rq, u64 *slice) noexcept;
+    bool pull(runqueue &self) noexcept;
+    void push(runqueue &rq, task *t, u64 *t_wait) noexcept;
+    bool dispatch(runqueue &self) noexcept;
+    void schedule(runqueue &self, task *t, u64 slice) noexcept;
+public:
+    /* default parameters: all processors, memory bound tasks at nice 0 */
+    cfs(u32 ncpus = get_nprocs(), i32 mem_nice = 0) noexcept;
+    ~cfs() noexcept;
+
+    void enqueue(task *t) noexcept;
+
+    /*
+     *  Slab allocate new task sub class constructed from argument list,
+     *  give memory bound tasks their nice level and place it on an idle
+     *  cpu if there is one, otherwise on the cpu with the fewest queued
+     *  tasks, at that cpu's min_vruntime
+     */
+    template<typename T, typename... Args>
+    task *
+    enqueue(Args &&...args) noexcept
+    requires std::is_constructible_v<T, Args...> && std::is_base_of_v<task, T>
+    {
+        task *t = task_table::create<T>(std::forward<Args>(args)...);
+        if constexpr (std::is_same_v<T, mem_task>)
+            t->set_nice(mem_nice);
+        enqueue(t);
+        return t;
+    }
+};
+} // namespace scheduler
+#endif
@@ -0,0 +1,45 @@
+#ifndef SCHEDSIM_CPUACCT_H
+#define SCHEDSIM_CPUACCT_H
+
+#include <atomic>
+#include <sys/types.h>
+#include <sys/resource.h>
+#include "types.hpp"
+
+enum class cpuacct_source : u8 {
+    SCHEDSTAT,  // /proc/<pid>/schedstat: cpu time and run queue delay
+    CPUCLOCK    // clock_getcpuclockid: cpu time only
+};
+
+/* cpu time of a child process, in nanoseconds */
+struct cpu_sample {
+    u64     t_cpu;      // time spent on a cpu
+    u64     t_delay;    // time runnable but waiting for a cpu, if known
+};
+
+/*
+ *  Nanosecond cpu accounting of task processes. A live child (running or
+ *  stopped, not yet reaped) is sampled from /proc/<pid>/schedstat, which
+ *  also reports how long it waited on a kernel run queue; the file is
+ *  opened once per child and read with pread from then on. Without
+ *  schedstat, its process cpu-time clock is read instead. Once a child
+ *  has been reaped, only the rusage wait4 returned is left, which is
+ *  kept to microseconds.
+ */
+class cpuacct {
+private:
+    static std::atomic<bool>    no_schedstat;   // schedstat failed before
+public:
+    static std::atomic<u64>     t_accounted;    // ns charged to all tasks
+
+    /*
+     *  Sample a live child; false if it is gone. *fd caches its schedstat
+     *  fd: pass -1 the first time, the caller closes it when done
+     */
+    static bool sample(pid_t pid, int *fd, cpu_sample *s) noexcept;
+    /* utime + stime of ru in nanoseconds */
+    static u64 rusage_ns(const struct rusage *ru) noexcept;
+    static cpuacct_source source() noexcept;
+    static const char *name(cpuacct_source src) noexcept;
+};
+#endif
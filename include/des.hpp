@@ -0,0 +1,186 @@
+#ifndef SCHEDSIM_DES_H
+#define SCHEDSIM_DES_H
+
+#include <array>
+#include <deque>
+#include <queue>
+#include <vector>
+#include "types.hpp"
+#include "task.hpp"
+#include "mlfq.hpp"
+#include "stride.hpp"
+#include "srtf.hpp"
+
+/*
+ *  Discrete-event simulation mode. Policies run against a virtual clock
+ *  (microseconds) and an event priority queue instead of real children, so
+ *  millions of tasks on hundreds of virtual cpus take seconds. Tasks are
+ *  modelled by a service time and an optional cpu burst / I/O profile;
+ *  arrivals alternate between task kinds like scheduler::run and are sped
+ *  up with the number of virtual cpus so the per-cpu load stays constant.
+ */
+
+/* workload model, all times in virtual microseconds */
+#define DES_CPU_SERVICE_LO  4500000     // cpu_task total cpu demand
+#define DES_CPU_SERVICE_HI  6500000
+#define DES_MEM_SERVICE_LO  800000      // mem_task total cpu demand
+#define DES_MEM_SERVICE_HI  1200000
+#define DES_MEM_BURST_LO    5000        // mem_task cpu burst between waits
+#define DES_MEM_BURST_HI    15000
+#define DES_MEM_IO_LO       500         // mem_task wait after each burst
+#define DES_MEM_IO_HI       2000
+#define DES_ARRIVAL_LO      150000      // inter-arrival time of the real
+#define DES_ARRIVAL_HI      500000      // mode, which loads a box of
+#define DES_ARRIVAL_CPUS    12          // DES_ARRIVAL_CPUS to about 80%
+#define DES_STRIDE_TICKETS_LO   100     // tickets of a stride/lottery task
+#define DES_STRIDE_TICKETS_HI   1000
+
+namespace des {
+struct vtask {
+    u32         id;
+    task_kind   kind;
+    u32         level;          // policy defined priority level
+    u64         t_arrival;
+    u64         t_firstrun;
+    u64         t_laststop;     // last preemption or I/O completion
+    u64         t_waiting;      // time spent in the ready queue
+    u64         t_cpu;          // service received
+    u64         t_unused;       // slice time left when blocking or exiting
+    u64         service;        // remaining cpu demand
+    u64         burst;          // cpu burst length (0: never blocks)
+    u64         burst_left;     // remaining cpu until the next I/O wait
+    u64         io;             // I/O wait length
+    bool        started;
+};
+
+/* round robin with RR_TIMESLICE_US quanta */
+class rr_policy {
+private:
+    std::deque<u32> ready;
+public:
+    static constexpr const char *name = "rr";
+
+    void enqueue(std::vector<vtask> &tasks, u32 idx) noexcept;
+    bool pick(std::vector<vtask> &tasks, u32 &idx) noexcept;
+    u64 quantum(const vtask &t) const noexcept;
+    void preempted(std::vector<vtask> &tasks, u32 idx, u64 used) noexcept;
+    u64 boost_period() const noexcept;
+    void boost(std::vector<vtask> &tasks) noexcept;
+    void charge(std::vector<vtask> &tasks, u32 idx, u64 used) noexcept;
+    void leave(std::vector<vtask> &tasks, u32 idx, bool done) noexcept;
+    void report() const noexcept;
+};
+
+template<u32 N>
+constexpr const char *mlfq_name = "mlfq";
+template<>
+constexpr const char *mlfq_name<64> = "mlfq64";
+template<>
+constexpr const char *mlfq_name<140> = "mlfq140";
+
+/* N level feedback queue mirroring scheduler::basic_mlfq<N, Q> */
+template<u32 N = 4, typename Q = linear_quantum<>>
+class basic_mlfq_policy {
+private:
+    lazy_prio_array<u32, N> ready;
+public:
+    static constexpr const char *name = mlfq_name<N>;
+
+    void enqueue(std::vector<vtask> &tasks, u32 idx) noexcept;
+    bool pick(std::vector<vtask> &tasks, u32 &idx) noexcept;
+    u64 quantum(const vtask &t) const noexcept;
+    void preempted(std::vector<vtask> &tasks, u32 idx, u64 used) noexcept;
+    u64 boost_period() const noexcept;
+    void boost(std::vector<vtask> &tasks) noexcept;
+    void charge(std::vector<vtask> &tasks, u32 idx, u64 used) noexcept;
+    void leave(std::vector<vtask> &tasks, u32 idx, bool done) noexcept;
+    void report() const noexcept;
+};
+
+using mlfq_policy = basic_mlfq_policy<>;
+using mlfq64_policy = basic_mlfq_policy<64, linear_quantum<5000, 320000>>;
+using mlfq140_policy = basic_mlfq_policy<140, linear_quantum<2000, 280000>>;
+
+/*
+ *  Stride scheduling over stride_queue, with one ticket group per task
+ *  kind. Tasks draw DES_STRIDE_TICKETS_LO..HI tickets, so the share report
+ *  checks proportions between unequal clients. A task blocked on I/O
+ *  leaves the queue and is not entitled to service until it rejoins
+ */
+class stride_policy {
+protected:
+    stride_queue                queue;
+    std::deque<stride_client>   clients;    // by task index, stable
+    histogram                   t_pick;     // ns per pick
+
+    stride_policy(bool lottery) noexcept;
+public:
+    static constexpr const char *name = "stride";
+
+    stride_policy() noexcept;
+
+    void enqueue(std::vector<vtask> &tasks, u32 idx) noexcept;
+    bool pick(std::vector<vtask> &tasks, u32 &idx) noexcept;
+    u64 quantum(const vtask &t) const noexcept;
+    void preempted(std::vector<vtask> &tasks, u32 idx, u64 used) noexcept;
+    u64 boost_period() const noexcept;
+    void boost(std::vector<vtask> &tasks) noexcept;
+    void charge(std::vector<vtask> &tasks, u32 idx, u64 used) noexcept;
+    void leave(std::vector<vtask> &tasks, u32 idx, bool done) noexcept;
+    void report() const noexcept;
+};
+
+/* stride_policy drawing lottery tickets instead of comparing pass values */
+class lottery_policy : public stride_policy {
+public:
+    static constexpr const char *name = "lottery";
+
+    lottery_policy() noexcept;
+};
+
+/*
+ *  Shortest remaining time first mirroring scheduler::srtf: the ready set
+ *  of each kind is a heap by service received, and a pick compares the
+ *  two heads' predicted remaining demand. A task's demand is observed when
+ *  it exits, over all of its bursts
+ */
+class srtf_policy {
+private:
+    struct entry {
+        u64     used;       // t_cpu when queued
+        u64     seq;        // FIFO order among equal service
+        u32     idx;
+
+        bool
+        operator<(const entry &e) const noexcept
+        {
+            return used != e.used ? used < e.used : seq > e.seq;
+        }
+    };
+
+    runtime_predictor                       pred;
+    std::array<std::priority_queue<entry>, 2> ready;    // by task_kind
+    std::vector<u64>                        predicted;  // by task index
+    u64                                     seq = 0;
+public:
+    static constexpr const char *name = "srtf";
+
+    void enqueue(std::vector<vtask> &tasks, u32 idx) noexcept;
+    bool pick(std::vector<vtask> &tasks, u32 &idx) noexcept;
+    u64 quantum(const vtask &t) const noexcept;
+    void preempted(std::vector<vtask> &tasks, u32 idx, u64 used) noexcept;
+    u64 boost_period() const noexcept;
+    void boost(std::vector<vtask> &tasks) noexcept;
+    void charge(std::vector<vtask> &tasks, u32 idx, u64 used) noexcept;
+    void leave(std::vector<vtask> &tasks, u32 idx, bool done) noexcept;
+    void report() const noexcept;
+};
+
+/*
+ *  Simulate ntasks arrivals on ncpus virtual cpus under policy P and print
+ *  the same metrics report as the real-process mode
+ */
+template<typename P>
+void run(u64 ntasks, u32 ncpus) noexcept;
+} // namespace des
+#endif
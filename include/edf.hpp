@@ -0,0 +1,129 @@
+#ifndef SCHEDSIM_EDF_H
+#define SCHEDSIM_EDF_H
+
+#include <iostream>
+#include <queue>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <type_traits>
+#include <pthread.h>
+#include <semaphore.h>
+#include <sys/sysinfo.h>
+#include "types.hpp"
+#include "task.hpp"
+#include "tasktable.hpp"
+#include "histogram.hpp"
+
+#define EDF_QUANTUM_US      10000       // longest slice between decisions
+#define EDF_MIN_SLICE_US    1000        // shortest slice to finish a budget
+#define EDF_IDLE_WAIT_US    10000
+#define EDF_STOP_FLAG       0x1
+#define EDF_STOP(flag)      ((flag) & EDF_STOP_FLAG)
+#define EDF_UNIT            1000000     // utilization of one cpu
+#define EDF_MEM_DEADLINE_US 2000000     // mem_task: one job due in 2 s
+#define EDF_MEM_BUDGET_US   1200000
+#define EDF_CPU_PERIOD_US   100000      // cpu_task: 25 ms every 100 ms
+#define EDF_CPU_BUDGET_US   25000
+
+/* timing parameters of a real-time task, in us */
+struct rt_params {
+    u64     deadline;       // relative deadline of each job
+    u64     period;         // release period (0: aperiodic, a single job)
+    u64     budget;         // worst case cpu time of each job
+};
+
+namespace scheduler {
+/*
+ *  Global earliest deadline first. Ready tasks are ordered by the absolute
+ *  deadline of their current job, and a task runs for at most
+ *  EDF_QUANTUM_US before the earliest deadline is chosen again.
+ *
+ *  An aperiodic task is a single job that completes when the task exits.
+ *  A periodic task releases a job every period, and each job may use
+ *  budget us of cpu time. Once a job has used its budget it completes,
+ *  and the task is throttled until its next release. A job misses its
+ *  deadline if it completes after it.
+ *
+ *  Admission control keeps the sum of budget / min(deadline, period)
+ *  over the admitted tasks within ncpus. This is the density bound, which
+ *  is exact on one cpu. On several cpus global EDF can still miss
+ *  deadlines below it.
+ */
+class edf {
+private:
+    using rt_queue = std::priority_queue<task *, std::vector<task *>,
+                                         bool (*)(task *, task *)>;
+
+    rt_queue                    ready;      // by absolute deadline
+    rt_queue                    throttled;  // by next release
+    u64                         util;       // admitted density, EDF_UNIT
+    u64                         capacity;
+    u64                         seq;
+    u64                         nr_admitted;
+    u64                         nr_rejected;
+    u64                         nr_throttled;
+    pthread_mutex_t             mtx;        // lock for the above
+    sem_t                       sem;        // queued tasks
+    std::vector<std::thread>    threads;
+    std::atomic<u8>             flag;
+
+    static u64 now_us() noexcept;
+    static u64 cpu_us(const task *t) noexcept;
+    static u64 density(const rt_entity &rt) noexcept;
+    static bool later_deadline(task *a, task *b) noexcept;
+    static bool later_release(task *a, task *b) noexcept;
+
+    bool admit(task *t, const rt_params &p) noexcept;
+    void push(task *t) noexcept;
+    task *pick(u64 now, u64 *wait_us) noexcept;
+    void complete(task *t, u64 now) noexcept;
+    void schedule(task *t) noexcept;
+    void work() noexcept;
+
+    template<typename T>
+    static rt_params
+    defaults() noexcept
+    {
+        if constexpr (std::is_same_v<T, cpu_task>)
+            return { EDF_CPU_PERIOD_US, EDF_CPU_PERIOD_US, EDF_CPU_BUDGET_US };
+        else
+            return { EDF_MEM_DEADLINE_US, 0, EDF_MEM_BUDGET_US };
+    }
+public:
+    static histogram            lateness;   // ns past a missed deadline
+    static std::atomic<u64>     nr_jobs;    // jobs completed
+    static std::atomic<u64>     nr_misses;  // jobs completed late
+
+    edf(u32 ncpus = get_nprocs()) noexcept;
+    ~edf() noexcept;
+
+    /*
+     *  Slab allocate new task sub class constructed from argument list with
+     *  timing parameters p, and release its first job now. Returns nullptr
+     *  if admission control rejects the task
+     */
+    template<typename T, typename... Args>
+    task *
+    enqueue(const rt_params &p, Args &&...args) noexcept
+    requires std::is_constructible_v<T, Args...> && std::is_base_of_v<task, T>
+    {
+        task *t = task_table::create<T>(std::forward<Args>(args)...);
+        if (!admit(t, p)) {
+            task_table::destroy(t);
+            return nullptr;
+        }
+        return t;
+    }
+
+    /* as above, with the default parameters of T's kind */
+    template<typename T, typename... Args>
+    task *
+    enqueue(Args &&...args) noexcept
+    requires std::is_constructible_v<T, Args...> && std::is_base_of_v<task, T>
+    {
+        return enqueue<T>(defaults<T>(), std::forward<Args>(args)...);
+    }
+};
+} // namespace scheduler
+#endif
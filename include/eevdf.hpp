@@ -0,0 +1,91 @@
+#ifndef SCHEDSIM_EEVDF_H
+#define SCHEDSIM_EEVDF_H
+
+#include <iostream>
+#include <atomic>
+#include <type_traits>
+#include <sys/resource.h>
+#include <sys/sysinfo.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include "types.hpp"
+#include "task.hpp"
+#include "tasktable.hpp"
+#include "rbtree.hpp"
+#include "percpu.hpp"
+
+#define EEVDF_BASE_SLICE_NS 24000000    // request size at latency nice 0
+#define EEVDF_MIN_SLICE_NS  1000000     // shortest request size
+#define EEVDF_IDLE_WAIT_US  10000       // idle worker retries pulls every 10 ms
+
+namespace scheduler {
+struct eevdf_rq : percpu_rq {
+    rb_tree                 timeline;       // queued tasks by vruntime
+    u64                     min_vruntime;   // monotonic timeline floor
+    i64                     avg_vruntime;   // sum (vruntime - min) * w
+    u64                     avg_load;       // sum of queued weights
+    u64                     nr_early;       // picks left of leftmost
+    u64                     nr_pulls;       // tasks pulled from others
+    u64                     nr_peak;        // most tasks queued at once
+};
+
+/*
+ *  Earliest Eligible Virtual Deadline First: every pinned worker keeps a
+ *  timeline of its queued tasks ordered by vruntime. A task is eligible
+ *  when it has not received more than its share, i.e. its vruntime is not
+ *  past the load weighted average vruntime V of the timeline, and the
+ *  eligible task with the earliest virtual deadline runs next. A deadline
+ *  is vruntime plus the task's request size (slice) scaled by its weight;
+ *  the slice follows the latency nice hint, so low latency tasks get
+ *  earlier deadlines at the cost of shorter, more frequent slices.
+ *
+ *  The timeline is augmented with the earliest deadline of every subtree,
+ *  so picking is O(log n). Tasks that leave a timeline (pulled by an idle
+ *  cpu) keep their lag V - vruntime and are placed relative to V of the
+ *  timeline they join.
+ */
+class eevdf : public percpu<eevdf, eevdf_rq> {
+private:
+    friend class percpu<eevdf, eevdf_rq>;
+    using runqueue = eevdf_rq;
+
+    i32                     mem_latency_nice; // hint for mem_task
+
+    u64 avg_vruntime(const runqueue &rq) const noexcept;
+    bool eligible(const runqueue &rq, const sched_entity *se) const noexcept;
+    void update_min_vruntime(runqueue &rq) noexcept;
+    void insert(runqueue &rq, sched_entity *se) noexcept;
+    void remove(runqueue &rq, sched_entity *se) noexcept;
+    void place_entity(runqueue &rq, sched_entity *se) noexcept;
+    sched_entity *pick_eevdf(runqueue &rq) noexcept;
+    sched_entity *pick(runqueue &rq) noexcept;
+    bool pull(runqueue &self) noexcept;
+    void push(runqueue &rq, task *t, bool join, u64 *t_wait) noexcept;
+    bool dispatch(runqueue &self) noexcept;
+    void schedule(runqueue &self, task *t) noexcept;
+public:
+    /* default parameters: all processors, no latency hint for mem_task */
+    eevdf(u32 ncpus = get_nprocs(), i32 mem_latency_nice = 0) noexcept;
+    ~eevdf() noexcept;
+
+    void enqueue(task *t) noexcept;
+
+    /*
+     *  Slab allocate new task sub class constructed from argument list,
+     *  apply the memory bound latency hint and place it on an idle cpu if
+     *  there is one, otherwise on the cpu with the fewest queued tasks
+     */
+    template<typename T, typename... Args>
+    task *
+    enqueue(Args &&...args) noexcept
+    requires std::is_constructible_v<T, Args...> && std::is_base_of_v<task, T>
+    {
+        task *t = task_table::create<T>(std::forward<Args>(args)...);
+        if constexpr (std::is_same_v<T, mem_task>)
+            t->set_latency_nice(mem_latency_nice);
+        enqueue(t);
+        return t;
+    }
+};
+} // namespace scheduler
+#endif
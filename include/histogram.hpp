@@ -0,0 +1,40 @@
+#ifndef SCHEDSIM_HISTOGRAM_H
+#define SCHEDSIM_HISTOGRAM_H
+
+#include <array>
+#include <atomic>
+#include "types.hpp"
+
+#define HIST_SUB_BITS   5                           // 32 linear sub-buckets
+#define HIST_SUB        (1U << HIST_SUB_BITS)
+#define HIST_GROUPS     60                          // covers the u64 range
+#define HIST_BUCKETS    (HIST_SUB * HIST_GROUPS)
+
+/*
+ *  Log-linear histogram: values below HIST_SUB get their own bucket, every
+ *  power of two above that is split into HIST_SUB linear sub-buckets, so
+ *  any recorded value is reproduced within ~3%. Counters are relaxed
+ *  atomics so any thread can record without a lock.
+ */
+class histogram {
+private:
+    std::array<std::atomic<u64>, HIST_BUCKETS> counts;
+    std::atomic<u64>                            total;
+    std::atomic<u64>                            sum;
+    std::atomic<u64>                            vmax;
+
+    static u32 bucket(u64 v) noexcept;
+    static u64 lowest(u32 idx) noexcept;
+public:
+    histogram() noexcept;
+
+    void record(u64 v) noexcept;
+    void merge(const histogram &h) noexcept;
+    void reset() noexcept;
+
+    u64 count() const noexcept;
+    u64 max() const noexcept;
+    double mean() const noexcept;
+    u64 percentile(double p) const noexcept;
+};
+#endif
@@ -0,0 +1,46 @@
+#ifndef SCHEDSIM_LATENCY_H
+#define SCHEDSIM_LATENCY_H
+
+#include <atomic>
+#include "types.hpp"
+#include "task.hpp"
+#include "histogram.hpp"
+#include "registry.hpp"
+
+#define LAT_KINDS       2           // task_kind::CPU, task_kind::MEM
+#define LAT_LEVELS      140         // deepest mlfq configuration
+#define LAT_NO_LEVEL    UINT32_MAX  // slice not run from an mlfq level
+
+enum class lat_metric : u8 {
+    TURNAROUND, // completion - arrival
+    RESPONSE,   // first run - arrival
+    WAITING,    // time spent queued
+    OVERSHOOT,  // stop time past the requested slice length
+    NR
+};
+
+/*
+ *  Latency distributions of the live schedulers, per task class and, for
+ *  slice overshoot, per mlfq level. Every thread records into histograms
+ *  of its own, so the hot path is a few relaxed adds on cache lines no
+ *  other thread writes; readers merge the shards of all threads.
+ */
+class latency {
+private:
+    struct shard {
+        histogram                   by_kind[(u32)lat_metric::NR][LAT_KINDS];
+        std::atomic<histogram *>    by_level[LAT_LEVELS];   // on first use
+    };
+
+    static thread_registry<shard>   shards;
+public:
+    static void record(lat_metric m, task_kind k, u64 ns) noexcept;
+    /* overshoot of a slice run at mlfq level lvl */
+    static void record_level(u32 lvl, u64 ns) noexcept;
+
+    /* add the histograms of all threads for m and k into out */
+    static void merge(lat_metric m, task_kind k, histogram *out) noexcept;
+    /* as above for the overshoot at lvl; false if nothing was recorded */
+    static bool merge_level(u32 lvl, histogram *out) noexcept;
+};
+#endif
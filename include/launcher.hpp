@@ -0,0 +1,49 @@
+#ifndef SCHEDSIM_LAUNCHER_H
+#define SCHEDSIM_LAUNCHER_H
+
+#include <mutex>
+#include <vector>
+#include <sys/types.h>
+#include "types.hpp"
+
+#define LAUNCH_STOPPED_ENV  "SCHEDSIM_STOPPED"   // child stops after exec
+
+enum class launch_method : u8 {
+    FORK,       // fork + execve from the calling scheduler thread
+    SPAWN,      // posix_spawn (clone with CLONE_VM | CLONE_VFORK in glibc)
+    VFORK,      // vfork + execve
+    ZYGOTE      // request the child from a pre-started fork server
+};
+
+/*
+ *  Task process launcher. Children are exec'd from the workload binaries
+ *  and, when requested stopped, park themselves with SIGSTOP right after
+ *  exec (the binaries honor LAUNCH_STOPPED_ENV); spawn then only returns
+ *  once the stop has been observed, so the caller owns an exec'd, stopped
+ *  child it can start with SIGCONT.
+ *
+ *  The zygote is a small single threaded process forked by init before any
+ *  scheduler thread exists. It double forks each child, and schedsim is
+ *  made a child subreaper so the orphaned grandchild is reparented to it
+ *  and can be waited on exactly like a directly forked child.
+ */
+class launcher {
+private:
+    static launch_method        method;
+    static int                  sock;       // zygote request socket
+    static pid_t                zygote;     // fork server pid
+    static std::mutex           mtx;        // serializes zygote requests
+    static std::vector<char *>  envp_run;   // environment for running child
+    static std::vector<char *>  envp_stop;  // environment + stop request
+
+    static void zygote_main(int fd) noexcept;
+    static pid_t zygote_spawn(const char *path, char *const argv[],
+                              bool stopped) noexcept;
+public:
+    static void init(launch_method m) noexcept;
+    static launch_method get_method() noexcept;
+    static const char *name(launch_method m) noexcept;
+    static pid_t spawn(const char *path, char *const argv[],
+                       bool stopped = false) noexcept;
+};
+#endif
@@ -0,0 +1,93 @@
+#ifndef SCHEDSIM_LOGGER_H
+#define SCHEDSIM_LOGGER_H
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <sys/types.h>
+#include "types.hpp"
+#include "registry.hpp"
+
+#define LOG_RING        1024    // records buffered per thread
+#define LOG_FLUSH_MS    20      // between batches of the writer thread
+
+/* compile out every record above this level (make LOG=0 drops them all) */
+#ifndef LOG_MAX_LEVEL
+#define LOG_MAX_LEVEL   2
+#endif
+
+enum class log_level : u8 {
+    OFF,        // nothing
+    INFO,       // task starts and exits
+    DEBUG       // every scheduling decision worth a line
+};
+
+enum class log_event : u8 {
+    STARTED,    // first run of the task
+    EXITED,     // the task exited
+    DEMOTED,    // moved down a level; arg: the new level
+    STOLEN      // taken by another cpu; arg: the thief
+};
+
+struct log_record {
+    u64         ts;     // steady_clock ns, orders records across threads
+    u32         task;   // task id
+    pid_t       pid;
+    u32         arg;
+    log_event   ev;
+};
+
+/*
+ *  Asynchronous logger for the scheduling hot path. A scheduler thread
+ *  copies a fixed-size record into a single-producer ring of its own and
+ *  moves on; it never formats, locks or blocks, and a record that finds
+ *  its ring full is dropped and counted. The writer thread drains all
+ *  rings every LOG_FLUSH_MS, orders the batch by time, formats it and
+ *  writes it with one call.
+ *
+ *  Records go through LOG(), which is compiled out above LOG_MAX_LEVEL
+ *  and otherwise costs a load and a branch below the run time level.
+ */
+class logger {
+private:
+    struct ring {
+        std::array<log_record, LOG_RING>    buf;
+        alignas(64) std::atomic<u64>        head;   // written by the owner
+        alignas(64) std::atomic<u64>        tail;   // written by the writer
+    };
+
+    static thread_registry<ring>    rings;
+    static std::mutex               mtx;        // lock for drain() and stop
+    static std::condition_variable  cv;
+    static std::thread              writer;
+    static bool                     stop;
+    static std::atomic<u8>          level;
+    static std::atomic<u64>         dropped;
+
+    static void drain() noexcept;
+    static void run() noexcept;
+public:
+    static void init(log_level lvl) noexcept;
+    static void shutdown() noexcept;
+    /* write out everything recorded so far */
+    static void flush() noexcept;
+
+    static bool
+    enabled(log_level lvl) noexcept
+    {
+        return (u8)lvl <= level.load(std::memory_order_relaxed);
+    }
+
+    static void log(log_event ev, u32 task, pid_t pid, u32 arg) noexcept;
+};
+
+#define LOG(lvl, ev, t, arg)                                            \
+    do {                                                                \
+        if constexpr ((u32)log_level::lvl <= LOG_MAX_LEVEL)             \
+            if (logger::enabled(log_level::lvl))                        \
+                logger::log(log_event::ev, (t)->get_task_id(),          \
+                            (t)->get_pid(), (arg));                     \
+    } while (0)
+#endif
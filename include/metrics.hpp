@@ -6,6 +6,8 @@
 #include <sys/time.h>
 #include "types.hpp"
 #include "task.hpp"
+#include "histogram.hpp"
+#include "perfctr.hpp"
 
 /*  Scheduling Metrics:
  *      - (1)  Average Turnaround Time (finish time - start time)
@@ -14,7 +16,8 @@
  *      - (4)  Average Time Spent Running (time spent executing)
  *      - (5)  CPU Utilization (cpu time / total uptime)
  *      - (6)  Throughput (tasks per second)
- *      - (7)  Scheduling Fairness
+ *      - (7)  Scheduling Fairness (Jain's index of the cpu share each task
+ *             received while in the system, t_cpu / turnaround)
  *  Other Metrics:
  *      - (8)  Total Number of Tasks
  *      - (9)  Total Number of CPU Bound Tasks
@@ -23,34 +26,84 @@
  *      - (12) Average Runtime for CPU Bound Tasks
  *      - (13) Average Runtime for Memory Bound Tasks
  *      - (14) Total Simulation Uptime (seconds)
+ *      - (15) Slice Time Reclaimed (unused quanta of tasks that exited early)
+ *      - (22) Kernel Run Queue Delay (runnable child waiting for a cpu, from
+ *             /proc/<pid>/schedstat)
+ *  Timing Accuracy:
+ *      - (16) Slice Overshoot (stop time past the requested slice length)
+ *  Latency Distributions (p50/p90/p99/p99.9/max, see latency.hpp):
+ *      - (23) Turnaround, Response and Waiting Time per task class
+ *      - (24) Slice Overshoot per task class and per mlfq level
+ *  Process Pool:
+ *      - (18) Pool Hits / Misses (task starts served by a parked process)
+ *  Scheduler Specific:
+ *      - (19) Runtime Prediction Error (srtf, relative to the actual demand)
+ *      - (20) Deadline Miss Ratio (edf, jobs completed after their deadline)
+ *      - (21) Lateness (edf, time past the deadline of the missed jobs)
+ *  Fairness:
+ *      - (25) Slowdown per task class (turnaround / cpu time, min and max)
+ *      - (26) Windowed Fairness (Jain's index of the cpu time each task
+ *             received in every snapshot interval, see aggregator.hpp)
+ *  Scheduler Overhead (p50/p90/p99/p99.9/max and total, see overhead.hpp):
+ *      - (17) SIGSTOP Latency (SIGSTOP sent until wait4 reports the stop)
+ *      - (27) Lock Wait (run queue mutexes) and Semaphore Wait (idle workers)
+ *      - (28) Dispatch (dequeue until the task is continued or started)
+ *      - (29) Launch (fork/exec of a task process) and task::get_state
+ *      - (30) Busy overhead per scheduler thread (min/mean/max)
+ *  Performance Counters (per task class, see perfctr.hpp):
+ *      - (31) IPC and LLC Misses per 1k Instructions (hardware counters)
+ *      - (32) Context Switches, Migrations and Page Faults per cpu second
  */
 class metrics {
 private:
-    float avg_t_turnaround; // 1
-    float avg_t_response;   // 2
-    float avg_t_waiting;    // 3
-    float avg_t_running;    // 4
-    float cpu_utilization;  // 5
-    float throughput;       // 6
+    double avg_t_turnaround; // 1
+    double avg_t_response;   // 2
+    double avg_t_waiting;    // 3
+    double avg_t_running;    // 4
+    double cpu_utilization;  // 5
+    double throughput;       // 6
+    double fairness;         // 7
+    double sum_share;        // 7, of t_cpu / turnaround per task
+    double sum_share_sq;     // 7, of its square
 
-    u32 num_tasks;          // 8
-    u32 num_cpu_tasks;      // 9
-    u32 num_mem_tasks;      // 10
+    u32 num_tasks;           // 8
+    u32 num_cpu_tasks;       // 9
+    u32 num_mem_tasks;       // 10
     
-    float avg_rt_cpu_tasks; // 11
-    float avg_rt_mem_tasks; // 12
+    double avg_rt_cpu_tasks; // 11
+    double avg_rt_mem_tasks; // 12
 
-    float t_total;          // 13
+    double t_total;          // 13
+    double t_reclaimed;      // 15
+    double avg_t_rqdelay;    // 22
+    double min_slowdown[2];  // 25, per task_kind
+    double max_slowdown[2];  // 25, per task_kind
+    u64 perf[2][(u32)perf_counter::NR]; // 31-32, per task_kind
+    u32 num_perf[2];         // 31-32, tasks that had counters
 
     /* helper functions */
-    bool is_cpu_task(task *t) const noexcept;
-    bool is_mem_task(task *t) const noexcept;
-    float get_cpu_time(const struct rusage *ru) const noexcept;
-    float get_time_diff(const struct timeval &l, const struct timeval &r)
-    const noexcept;
+    static double ms(nanoseconds t) noexcept;
+    static std::ostream &
+    print_percentiles(std::ostream &os, const histogram &h);
+    static std::ostream &
+    print_tail(std::ostream &os, const histogram &h, double unit_ns,
+               const char *unit);
+    static std::ostream &print_latency(std::ostream &os);
+    static std::ostream &print_overhead(std::ostream &os);
+    std::ostream &print_perf(std::ostream &os) const;
 public:
-    metrics(const std::vector<task *> &tasks, 
-            const struct timeval &t_start) noexcept;
+    metrics() noexcept;
+
+    /* Jain's index of x given the sum and sum of squares of n samples */
+    static double jain(double sum, double sum_sq, u64 n) noexcept;
+
+    /* accumulate one finished task */
+    void add(const task *t) noexcept;
+    /* accumulate one finished task (times in ms) */
+    void add(task_kind kind, double t_turnaround, double t_response,
+             double t_waiting, double t_cpu, double t_unused) noexcept;
+    /* turn the sums into averages over t_total ms on ncpus cpus */
+    void finalize(double t_total_ms, u32 ncpus) noexcept;
     
     friend std::ostream &
     operator<<(std::ostream &os, const metrics& m);
@@ -2,8 +2,11 @@
 #define SCHEDSIM_MLFQ_H
 
 #include <iostream>
-#include <queue>
+#include <deque>
 #include <array>
+#include <bit>
+#include <vector>
+#include <memory>
 #include <atomic>
 #include <type_traits>
 #include <sys/wait.h>
@@ -15,6 +18,7 @@
 #include <semaphore.h>
 #include "types.hpp"
 #include "task.hpp"
+#include "tasktable.hpp"
 
 #define MLFQ_STOP_FLAG      0x1 // finish remaining tasks and stop
 #define MLFQ_PRIO_FLAG      0x2 // priority boost 
@@ -26,32 +30,185 @@
 #define PRIOBOOSTFREQ_MS    2500    // 2500 ms priority boost frequency
 #define PRIOBOOSTFREQ_US    2500000 // priority boost frequency in microseconds
 
+/*
+ *  Quantum policies of the feedback queue: us(level) is the slice length
+ *  at a level. Quanta grow by step_us per level up to max_us; the default
+ *  (20 ms steps, no cap) is TIMESLICE_US
+ */
+template<u64 step_us = 20000, u64 max_us = ~0ULL>
+struct linear_quantum {
+    static constexpr u64
+    us(u32 level) noexcept
+    {
+        return (level + 1) * step_us < max_us ? (level + 1) * step_us
+                                              : max_us;
+    }
+};
+
+/*
+ *  Priority array: one FIFO per level and a bitmap of the non-empty ones,
+ *  as in the Linux O(1) scheduler. The highest priority (lowest) non-empty
+ *  level is found with a find-first-set over (N + 63) / 64 words, so a pick
+ *  costs the same however many levels are empty. Not thread safe
+ */
+template<typename T, u32 N>
+class prio_array {
+private:
+    static constexpr u32 words = (N + 63) / 64;
+
+    std::array<std::deque<T>, N>    queues;
+    std::array<u64, words>          bitmap;     // bit l: queues[l] non-empty
+public:
+    static constexpr u32 levels = N;
+
+    prio_array() noexcept
+        : bitmap{}
+    {}
+
+    /* first non-empty level, or N */
+    u32
+    first() const noexcept
+    {
+        for (u32 w = 0; w < words; ++w)
+            if (bitmap[w])
+                return w * 64 + std::countr_zero(bitmap[w]);
+        return N;
+    }
+
+    bool
+    empty() const noexcept
+    {
+        return first() == N;
+    }
+
+    void
+    push(T t, u32 lvl) noexcept
+    {
+        queues[lvl].push_back(t);
+        bitmap[lvl / 64] |= 1ULL << (lvl % 64);
+    }
+
+    /* pop the head of the first non-empty level; false if there is none */
+    bool
+    pop(T *t, u32 *lvl) noexcept
+    {
+        u32 l = first();
+        if (l == N)
+            return false;
+        *t = queues[l].front();
+        queues[l].pop_front();
+        if (queues[l].empty())
+            bitmap[l / 64] &= ~(1ULL << (l % 64));
+        *lvl = l;
+        return true;
+    }
+};
+
+/*
+ *  Priority array with O(1) priority boosts. A boost retires the active
+ *  array and opens a fresh one instead of moving every element to the top
+ *  level. Retired arrays are served first, oldest first, each in its own
+ *  level order, and what is popped from them is promoted to level 0 then.
+ *  That is the order a stop-the-world boost gives: the old level 0, then
+ *  the boosted levels, then anything pushed later. Drained arrays are
+ *  kept for reuse. Not thread safe
+ */
+template<typename T, u32 N>
+class lazy_prio_array {
+private:
+    using array = prio_array<T, N>;
+
+    std::deque<std::unique_ptr<array>>  arrays;     // back: active
+    std::vector<std::unique_ptr<array>> spare;      // drained, for reuse
+    u64                                 nr_boosts;  // boosts applied
+public:
+    static constexpr u32 levels = N;
+
+    lazy_prio_array() noexcept
+        : nr_boosts(0)
+    {
+        arrays.push_back(std::make_unique<array>());
+    }
+
+    u64
+    get_nr_boosts() const noexcept
+    {
+        return nr_boosts;
+    }
+
+    void
+    push(T t, u32 lvl) noexcept
+    {
+        arrays.back()->push(t, lvl);
+    }
+
+    /* pop the highest priority element; false if there is none */
+    bool
+    pop(T *t, u32 *lvl) noexcept
+    {
+        while (arrays.size() > 1) {
+            if (arrays.front()->pop(t, lvl)) {
+                *lvl = 0;
+                return true;
+            }
+            spare.push_back(std::move(arrays.front()));
+            arrays.pop_front();
+        }
+        return arrays.back()->pop(t, lvl);
+    }
+
+    /* everything queued now is at level 0, ahead of later pushes */
+    void
+    boost() noexcept
+    {
+        if (arrays.back()->empty())
+            return;
+        if (spare.empty()) {
+            arrays.push_back(std::make_unique<array>());
+        } else {
+            arrays.push_back(std::move(spare.back()));
+            spare.pop_back();
+        }
+        nr_boosts++;
+    }
+};
+
 namespace scheduler {
-class mlfq {
+/*
+ *  Multi-Level Feedback Queue over N levels with slices from the quantum
+ *  policy Q. A task that used a whole slice worth of cpu time at a level
+ *  is demoted one level, and every PRIOBOOSTFREQ_US all tasks are boosted
+ *  back to the top level. Boosts are epochs of the scheduler clock, applied
+ *  by the next dispatch in O(1) (see lazy_prio_array). Instantiated in
+ *  mlfq.cpp for 4, 64 and 140 levels
+ */
+template<u32 N = 4, typename Q = linear_quantum<>>
+class basic_mlfq {
 private:
-    std::array<std::queue<task *>, 4>   tasks;      // array of queues per level
+    lazy_prio_array<task *, N>          tasks;      // level queues
     pthread_mutex_t                     task_mtx;   // lock for task queue
-    pthread_mutex_t                     io_mtx;     // lock for stdin/stdout
     sem_t                               sem;        // producer/consumer semaphore
     pthread_t                           *threads;   // workers
     u32                                 ncpus;      // number of cpus
     std::atomic<u8>                     flag;       // atomic flag for events
+    std::atomic<u64>                    t_lockwait; // ns spent in lock()
+    time_point<steady_clock>            t_epoch;    // start of boost epochs
+    u64                                 epoch;      // last boost epoch applied
     
-    u32 cpudiff(const struct rusage *prev, const struct rusage *cur) 
-    const noexcept;
+    void lock() noexcept;
+    void age() noexcept;
     void schedule(task *t, u32 lvl) noexcept;
 
     static void *schedworker(void *arg) noexcept;
-    static void *prioboostworker(void *arg) noexcept;
 public:
-    /* default parameters: all processors, 4 queue levels */
-    mlfq(u32 ncpus = get_nprocs()) noexcept;
-    ~mlfq() noexcept; 
+    /* default parameters: all processors */
+    basic_mlfq(u32 ncpus = get_nprocs()) noexcept;
+    ~basic_mlfq() noexcept; 
 
     void enqueue(task *t, u32 lvl = 0) noexcept; 
     
     /*  
-     *  Heap allocate new task sub class constructed from argument list
+     *  Slab allocate new task sub class constructed from argument list
      *  and push onto the task queue, acquiring mutex to protect task queue
      *  and increment semaphore for waiting scheduler threads
      */
@@ -60,15 +217,17 @@ public:
     enqueue(Args &&...args) noexcept 
     requires std::is_constructible_v<T, Args...> && std::is_base_of_v<task, T>
     {
-        task *t = new T(std::forward<Args>(args)...);
-        pthread_mutex_lock(&task_mtx);
-        tasks[0].push(t);
+        task *t = task_table::create<T>(std::forward<Args>(args)...);
+        lock();
+        tasks.push(t, 0);
         sem_post(&sem);
         pthread_mutex_unlock(&task_mtx);
         return t;
     }
 };
 
-
+using mlfq = basic_mlfq<>;
+using mlfq64 = basic_mlfq<64, linear_quantum<5000, 320000>>;
+using mlfq140 = basic_mlfq<140, linear_quantum<2000, 280000>>;
 } // namespace scheduler
 #endif
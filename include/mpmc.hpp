@@ -0,0 +1,94 @@
+#ifndef SCHEDSIM_MPMC_H
+#define SCHEDSIM_MPMC_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+
+/*
+ *  Bounded lock-free multi-producer/multi-consumer ring (Vyukov). Every
+ *  cell carries a sequence number: a producer may fill cell i of lap k when
+ *  its sequence equals the ticket, a consumer may drain it once the
+ *  producer has bumped it to ticket + 1. Neither side ever takes a lock, a
+ *  full or empty ring is reported by try_push/try_pop failing.
+ */
+template<typename T, size_t N>
+class mpmc_queue {
+    static_assert(N >= 2 && (N & (N - 1)) == 0,
+                  "mpmc_queue capacity must be a power of two");
+    static_assert(std::is_trivially_copyable_v<T>);
+private:
+    struct cell {
+        std::atomic<size_t> seq;
+        T                   data;
+    };
+
+    alignas(64) std::array<cell, N>     cells;
+    alignas(64) std::atomic<size_t>     head;   // next enqueue ticket
+    alignas(64) std::atomic<size_t>     tail;   // next dequeue ticket
+public:
+    mpmc_queue() noexcept
+        : head(0), tail(0)
+    {
+        for (size_t i = 0; i < N; ++i)
+            cells[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    bool
+    try_push(T v) noexcept
+    {
+        size_t pos = head.load(std::memory_order_relaxed);
+        for (;;) {
+            cell &c = cells[pos & (N - 1)];
+            size_t seq = c.seq.load(std::memory_order_acquire);
+            intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+            if (dif == 0) {
+                if (head.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed))
+                {
+                    c.data = v;
+                    c.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (dif < 0) {
+                return false;   // full
+            } else {
+                pos = head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool
+    try_pop(T &v) noexcept
+    {
+        size_t pos = tail.load(std::memory_order_relaxed);
+        for (;;) {
+            cell &c = cells[pos & (N - 1)];
+            size_t seq = c.seq.load(std::memory_order_acquire);
+            intptr_t dif = (intptr_t)seq - (intptr_t)(pos + 1);
+            if (dif == 0) {
+                if (tail.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed))
+                {
+                    v = c.data;
+                    c.seq.store(pos + N, std::memory_order_release);
+                    return true;
+                }
+            } else if (dif < 0) {
+                return false;   // empty, or head cell not yet published
+            } else {
+                pos = tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /* racy snapshot: no ticket has been claimed that was not consumed */
+    bool
+    empty() const noexcept
+    {
+        return head.load(std::memory_order_acquire) ==
+               tail.load(std::memory_order_acquire);
+    }
+};
+#endif
@@ -0,0 +1,81 @@
+#ifndef SCHEDSIM_OVERHEAD_H
+#define SCHEDSIM_OVERHEAD_H
+
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <pthread.h>
+#include "types.hpp"
+#include "histogram.hpp"
+#include "registry.hpp"
+
+/* compile out the probes below with make OVERHEAD=0 */
+#ifndef OVERHEAD_PROBES
+#define OVERHEAD_PROBES 1
+#endif
+
+enum class ovh_metric : u8 {
+    LOCK_WAIT,  // acquiring a run queue mutex (task_mtx, rq.mtx, mtx)
+    SEM_WAIT,   // blocked on the run queue semaphore, idle time included
+    DISPATCH,   // schedule() entered until SIGCONT sent or the task started
+    STOP,       // SIGSTOP sent until wait4 reports the stop
+    LAUNCH,     // launcher::spawn, what starting a child costs the caller
+    GET_STATE,  // task::get_state falling back to /proc for a running task
+    NR
+};
+
+/*
+ *  Self-overhead of the simulator: where a scheduler thread spends its time
+ *  other than letting a task run. Every thread records into a shard of
+ *  histograms of its own and the report merges them, so the cost on
+ *  the hot path is a clock read and a few relaxed adds. Each shard also
+ *  stays attributable to its thread, so the report can show how the load
+ *  is spread over the workers as the cpu count grows.
+ *
+ *  Probes go through the OVERHEAD_*() macros, which make OVERHEAD=0
+ *  compiles out. overhead::lock() still times the wait then, since the
+ *  schedulers keep their own lock wait totals, but records nothing.
+ */
+class overhead {
+private:
+    struct shard {
+        histogram   hist[(u32)ovh_metric::NR];
+    };
+
+    static thread_registry<shard>   shards;
+public:
+    static void record(ovh_metric m, u64 ns) noexcept;
+
+    /* record the time from t0 until now */
+    static void
+    since(ovh_metric m, time_point<steady_clock> t0) noexcept
+    {
+        record(m, duration_cast<nanoseconds>(
+            steady_clock::now() - t0
+        ).count());
+    }
+
+    /*
+     *  Acquire m, recording the time spent blocked on it (0 when the
+     *  trylock succeeds). Returns that time for callers keeping totals
+     */
+    static u64 lock(pthread_mutex_t *m) noexcept;
+
+    /* add the histograms of all threads for m into out */
+    static void merge(ovh_metric m, histogram *out) noexcept;
+    /* busy ns recorded by each thread (all but SEM_WAIT), if any */
+    static std::vector<u64> per_thread() noexcept;
+};
+
+#if OVERHEAD_PROBES
+#define OVERHEAD_START(t0)      auto t0 = steady_clock::now()
+#define OVERHEAD_SINCE(m, t0)   overhead::since(ovh_metric::m, (t0))
+#define OVERHEAD_RECORD(m, ns)  overhead::record(ovh_metric::m, (ns))
+#define OVERHEAD_LOCK(mtx)      overhead::lock(mtx)
+#else
+#define OVERHEAD_START(t0)      ((void)0)
+#define OVERHEAD_SINCE(m, t0)   ((void)0)
+#define OVERHEAD_RECORD(m, ns)  ((void)0)
+#define OVERHEAD_LOCK(mtx)      pthread_mutex_lock(mtx)
+#endif
+#endif
@@ -0,0 +1,235 @@
+#ifndef SCHEDSIM_PERCPU_H
+#define SCHEDSIM_PERCPU_H
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <iostream>
+#include <atomic>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <time.h>
+#include <err.h>
+#include "types.hpp"
+#include "overhead.hpp"
+
+#define PERCPU_STOP_FLAG    0x1
+#define PERCPU_STOP(flag)   ((flag) & PERCPU_STOP_FLAG)
+
+namespace scheduler {
+/*
+ *  State every per-cpu run queue has; a scheduler derives its run queue
+ *  from this and adds its own queue structure and counters
+ */
+struct alignas(64) percpu_rq {
+    pthread_mutex_t     mtx;            // lock for this cpu
+    sem_t               sem;            // wakeups for worker
+    void                *owner;         // owning scheduler
+    pthread_t           thread;         // pinned worker
+    u32                 cpu;            // cpu id
+    std::atomic<u32>    nr_queued;      // tasks on this run queue
+    std::atomic<bool>   idle;           // worker is waiting
+    u64                 nr_dispatch;    // slices dispatched
+    u64                 t_lockwait;     // ns spent in lock()
+};
+
+/*
+ *  Per-cpu scheduling engine shared by pmlfq, cfs and eevdf: one run queue
+ *  of type RQ and one pinned worker per cpu, idle workers parked on their
+ *  run queue's semaphore, wakeups of idle cpus when work is queued, and
+ *  the per-cpu report. S supplies the queueing policy through
+ *
+ *      bool dispatch(RQ &self)
+ *
+ *  which runs one slice from self (or takes work from another cpu) and
+ *  returns false if there was nothing to do. S constructs its own run
+ *  queue fields and then calls start(), and calls stop() first thing in
+ *  its destructor, so no worker ever sees a half built or torn down S.
+ */
+template<typename S, typename RQ>
+class percpu {
+private:
+    u32                 idle_us;    // idle worker rechecks after this
+
+    void
+    wait_idle(RQ &self) noexcept
+    {
+        /*
+         *  Publish that we are idle before the final check so an enqueue
+         *  either sees the flag and posts, or we see its task here
+         */
+        self.idle.store(true);
+        if (self.nr_queued.load() == 0) {
+            struct timespec ts;
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            ts.tv_nsec += idle_us * 1000;
+            ts.tv_sec += ts.tv_nsec / 1000000000;
+            ts.tv_nsec %= 1000000000;
+            OVERHEAD_START(t_idle);
+            sem_clockwait(&self.sem, CLOCK_MONOTONIC, &ts);
+            OVERHEAD_SINCE(SEM_WAIT, t_idle);
+        }
+        self.idle.store(false);
+    }
+
+    static void *
+    schedworker(void *arg) noexcept
+    {
+        RQ &self = *(RQ *)arg;
+        S *s = (S *)self.owner;
+        while (1) {
+            if (s->dispatch(self))
+                continue;
+            if (s->stopping())
+                break;
+            s->wait_idle(self);
+        }
+        return nullptr;
+    }
+protected:
+    RQ                  *rqs;       // one run queue per cpu
+    u32                 ncpus;      // number of cpus
+    std::atomic<u32>    next;       // placement cursor
+    std::atomic<u8>     flag;       // atomic flag for events
+
+    percpu(u32 ncpus, u32 idle_us) noexcept
+        : idle_us(idle_us),
+          rqs(new RQ[ncpus]),
+          ncpus(ncpus),
+          next(0),
+          flag(0)
+    {
+        for (u32 i = 0; i < ncpus; ++i) {
+            pthread_mutex_init(&rqs[i].mtx, nullptr);
+            sem_init(&rqs[i].sem, 0, 0);
+            rqs[i].owner = static_cast<S *>(this);
+            rqs[i].cpu = i;
+            rqs[i].nr_queued = 0;
+            rqs[i].idle = false;
+            rqs[i].nr_dispatch = 0;
+            rqs[i].t_lockwait = 0;
+        }
+    }
+
+    ~percpu() noexcept
+    {
+        for (u32 i = 0; i < ncpus; ++i) {
+            pthread_mutex_destroy(&rqs[i].mtx);
+            sem_destroy(&rqs[i].sem);
+        }
+        delete[] rqs;
+    }
+
+    /* launch one scheduler thread per cpu and pin to that cpu */
+    void
+    start() noexcept
+    {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        for (u32 i = 0; i < ncpus; ++i) {
+            CPU_SET(i, &cpus);
+            pthread_create(&rqs[i].thread, nullptr, schedworker, rqs + i);
+            if (pthread_setaffinity_np(rqs[i].thread, sizeof(cpu_set_t),
+                                       &cpus) < 0)
+                err(EXIT_FAILURE, "pthread_setaffinity_np");
+            CPU_CLR(i, &cpus);
+        }
+    }
+
+    /* let the workers drain their queues and join them */
+    void
+    stop() noexcept
+    {
+        flag.fetch_or(PERCPU_STOP_FLAG);
+        for (u32 i = 0; i < ncpus; ++i)
+            sem_post(&rqs[i].sem);
+        for (u32 i = 0; i < ncpus; ++i)
+            pthread_join(rqs[i].thread, nullptr);
+    }
+
+    bool
+    stopping() const noexcept
+    {
+        return PERCPU_STOP(flag.load());
+    }
+
+    /*
+     *  Acquire a run queue lock, charging the time spent blocked on it to
+     *  t_wait (if given) and to the overhead histograms
+     */
+    void
+    lock(RQ &rq, u64 *t_wait) noexcept
+    {
+        u64 ns = overhead::lock(&rq.mtx);
+        if (t_wait)
+            *t_wait += ns;
+    }
+
+    /* post to rq's worker if it is parked; after queueing on rq */
+    void
+    wake(RQ &rq) noexcept
+    {
+        if (rq.idle.load())
+            sem_post(&rq.sem);
+    }
+
+    /* wake one idle worker if self has more queued work than it can run */
+    void
+    kick(const RQ &self) noexcept
+    {
+        if (self.nr_queued.load() < 2)
+            return;
+        for (u32 i = 1; i < ncpus; ++i) {
+            RQ &rq = rqs[(self.cpu + i) % ncpus];
+            if (rq.idle.load()) {
+                sem_post(&rq.sem);
+                return;
+            }
+        }
+    }
+
+    /*
+     *  Prefer an idle cpu for new tasks, otherwise the cpu with the fewest
+     *  queued tasks (shortest) or the next cpu in round robin order
+     */
+    RQ &
+    place(bool shortest) noexcept
+    {
+        u32 start = next.fetch_add(1);
+        RQ *best = &rqs[start % ncpus];
+        for (u32 i = 0; i < ncpus; ++i) {
+            RQ &rq = rqs[(start + i) % ncpus];
+            if (rq.idle.load())
+                return rq;
+            if (shortest && rq.nr_queued.load() < best->nr_queued.load())
+                best = &rq;
+        }
+        return *best;
+    }
+
+    /*
+     *  Print one line per cpu, with the columns per_cpu(rq) adds between
+     *  the dispatches and the lock wait, then what totals() prints and the
+     *  total lock wait
+     */
+    template<typename F, typename G>
+    void
+    report(const char *name, F &&per_cpu, G &&totals) noexcept
+    {
+        u64 t_lockwait = 0;
+        std::cout << "\nPer-CPU " << name << " Statistics:\n";
+        for (u32 i = 0; i < ncpus; ++i) {
+            std::cout << "\tCPU " << i << ":\t"
+                      << rqs[i].nr_dispatch << " dispatches, ";
+            per_cpu(rqs[i]);
+            std::cout << rqs[i].t_lockwait / 1e6 << "ms lock wait\n";
+            t_lockwait += rqs[i].t_lockwait;
+        }
+        totals();
+        std::cout << "Total Lock Wait Time:\t\t\t" << t_lockwait / 1e6
+                  << "ms\n";
+    }
+};
+} // namespace scheduler
+#endif
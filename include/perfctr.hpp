@@ -0,0 +1,57 @@
+#ifndef SCHEDSIM_PERFCTR_H
+#define SCHEDSIM_PERFCTR_H
+
+#include <atomic>
+#include <sys/types.h>
+#include "types.hpp"
+
+enum class perf_counter : u8 {
+    TASK_CLOCK,     // software: ns on a cpu, the group leader
+    CTX_SWITCHES,   // software
+    MIGRATIONS,     // software: moves to another cpu
+    PAGE_FAULTS,    // software
+    INSTRUCTIONS,   // hardware, user mode
+    CYCLES,         // hardware, user mode
+    LLC_MISSES,     // hardware: last level cache misses, user mode
+    NR
+};
+
+enum class perfctr_source : u8 {
+    HARDWARE,       // all counters
+    SOFTWARE,       // no PMU (e.g. a guest without vPMU): software only
+    NONE            // perf_event_open not permitted
+};
+
+/* the counters of one task, totals as of the last read */
+struct perf_counters {
+    int     fd[(u32)perf_counter::NR];  // -1 if not opened
+    u64     val[(u32)perf_counter::NR];
+
+    perf_counters() noexcept;
+};
+
+/*
+ *  Per-task performance counters from perf_event_open, attached to a child
+ *  when it is launched and read as one group with a single read() every
+ *  time the task is stopped. Hardware counters count user mode only, so
+ *  IPC and cache misses are those of the workload; context switches and
+ *  migrations also count kernel mode where perf_event_paranoid allows it.
+ *  The first attach probes what the host offers: without a PMU only the
+ *  software counters are opened, without permission none are.
+ */
+class perfctr {
+private:
+    static std::atomic<u8>      src;        // perfctr_source
+    static std::atomic<bool>    user_only;  // kernel counting not permitted
+public:
+    /* open the counters of a newly launched child */
+    static void attach(perf_counters *pc, pid_t pid) noexcept;
+    /* update pc->val, also valid once the child has been reaped */
+    static void read(perf_counters *pc) noexcept;
+    static void detach(perf_counters *pc) noexcept;
+
+    static bool opened(const perf_counters &pc, perf_counter c) noexcept;
+    static perfctr_source source() noexcept;
+    static const char *name(perfctr_source src) noexcept;
+};
+#endif
@@ -0,0 +1,89 @@
+#ifndef SCHEDSIM_PMLFQ_H
+#define SCHEDSIM_PMLFQ_H
+
+#include <iostream>
+#include <vector>
+#include <atomic>
+#include <type_traits>
+#include <sys/resource.h>
+#include <sys/sysinfo.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include "types.hpp"
+#include "task.hpp"
+#include "tasktable.hpp"
+#include "mlfq.hpp"
+#include "percpu.hpp"
+
+#define PMLFQ_IDLE_WAIT_US  10000   // idle worker rechecks victims every 10 ms
+
+namespace scheduler {
+template<u32 N>
+struct pmlfq_rq : percpu_rq {
+    lazy_prio_array<task *, N>  tasks;      // per-cpu level queues
+    u64                         epoch;      // last boost epoch applied
+    u64                         nr_steals;  // tasks stolen
+};
+
+/*
+ *  Per-CPU Multi-Level Feedback Queue over N levels with slices from the
+ *  quantum policy Q: every pinned worker owns its own level queues and
+ *  lock, so dispatches and requeues only touch the local run queue. Local
+ *  picks and idle workers stealing from a victim run queue both take the
+ *  first task of the highest priority non-empty level, found from the
+ *  level bitmap. Every PRIOBOOSTFREQ_US all tasks are boosted to the top
+ *  level; as in basic_mlfq, boosts are epochs of the scheduler clock,
+ *  applied in O(1) by the next pop from each run queue. Instantiated in
+ *  pmlfq.cpp for 4, 64 and 140 levels
+ */
+template<u32 N = 4, typename Q = linear_quantum<>>
+class basic_pmlfq : public percpu<basic_pmlfq<N, Q>, pmlfq_rq<N>> {
+private:
+    using base = percpu<basic_pmlfq<N, Q>, pmlfq_rq<N>>;
+    using runqueue = pmlfq_rq<N>;
+    friend base;
+    using base::rqs;
+    using base::ncpus;
+    using base::lock;
+    using base::wake;
+    using base::kick;
+    using base::place;
+    using base::start;
+    using base::stop;
+    using base::report;
+
+    time_point<steady_clock>    t_epoch;    // start of boost epochs
+
+    void age(runqueue &rq) noexcept;
+    task *pop(runqueue &rq, u32 *lvl) noexcept;
+    task *steal(runqueue &self, u32 *lvl) noexcept;
+    void push(runqueue &rq, task *t, u32 lvl, u64 *t_wait) noexcept;
+    bool dispatch(runqueue &self) noexcept;
+    void schedule(runqueue &self, task *t, u32 lvl) noexcept;
+public:
+    basic_pmlfq(u32 ncpus = get_nprocs()) noexcept;
+    ~basic_pmlfq() noexcept;
+
+    void enqueue(task *t, u32 lvl = 0) noexcept;
+
+    /*
+     *  Slab allocate new task sub class constructed from argument list
+     *  and place it on an idle cpu if there is one, otherwise on the next
+     *  cpu in round robin order
+     */
+    template<typename T, typename... Args>
+    task *
+    enqueue(Args &&...args) noexcept
+    requires std::is_constructible_v<T, Args...> && std::is_base_of_v<task, T>
+    {
+        task *t = task_table::create<T>(std::forward<Args>(args)...);
+        enqueue(t);
+        return t;
+    }
+};
+
+using pmlfq = basic_pmlfq<>;
+using pmlfq64 = basic_pmlfq<64, linear_quantum<5000, 320000>>;
+using pmlfq140 = basic_pmlfq<140, linear_quantum<2000, 280000>>;
+} // namespace scheduler
+#endif
@@ -0,0 +1,49 @@
+#ifndef SCHEDSIM_PROCPOOL_H
+#define SCHEDSIM_PROCPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <initializer_list>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+#include <sys/types.h>
+#include "types.hpp"
+
+/*
+ *  Pool of pre-warmed task processes. For every registered workload binary
+ *  the pool keeps up to `size` children that are already exec'd and parked
+ *  in SIGSTOP (see launcher::spawn), so starting a task is a SIGCONT rather
+ *  than a fork and exec on the scheduler's critical path. A background
+ *  thread refills the pools as processes are handed out; when a pool is
+ *  empty the task is launched directly and counted as a miss.
+ */
+class procpool {
+private:
+    struct entry {
+        const char          *path;
+        char                *argv[2];
+        std::queue<pid_t>   pids;
+    };
+
+    static std::vector<entry>       pools;
+    static u32                      size;       // target processes per pool
+    static std::mutex               mtx;        // lock for pools
+    static std::condition_variable  cv;         // refill requests
+    static std::thread              refiller;
+    static bool                     stop;
+
+    static void refill() noexcept;
+    static bool needs_refill() noexcept;
+public:
+    static std::atomic<u64>         hits;       // launches served from pool
+    static std::atomic<u64>         misses;     // launches that had to spawn
+
+    static void init(u32 size, std::initializer_list<const char *> paths)
+    noexcept;
+    static void shutdown() noexcept;
+    static bool enabled() noexcept;
+    static pid_t launch(const char *path) noexcept;
+};
+#endif
@@ -0,0 +1,84 @@
+#ifndef SCHEDSIM_RBTREE_H
+#define SCHEDSIM_RBTREE_H
+
+#include <cstddef>
+#include "types.hpp"
+
+/*
+ *  Intrusive red-black tree. Nodes are embedded in the objects they order
+ *  (see sched_entity in task.hpp), so inserting and erasing never allocate.
+ *  The tree caches its leftmost node, which makes picking the minimum O(1)
+ *  and insert/erase O(log n). Equal keys are inserted after existing ones,
+ *  so ties are served in FIFO order.
+ *
+ *  An augmented tree is built by passing a callback that recomputes the
+ *  per-subtree value of a node from the node and its children; the tree
+ *  calls it on every node whose subtree changes.
+ */
+struct rb_node {
+    rb_node     *parent;
+    rb_node     *left;
+    rb_node     *right;
+    bool        red;
+};
+
+/* the object containing node, where node is the member field of type */
+#define rb_entry(node, type, field) \
+    ((type *)((char *)(node) - offsetof(type, field)))
+
+using rb_augment_fn = void (*)(rb_node *n);
+
+class rb_tree {
+private:
+    rb_node         *root;
+    rb_node         *leftmost;  // cached minimum
+    u64             nr_nodes;
+    rb_augment_fn   augment;    // subtree value callback, may be null
+
+    void rotate_left(rb_node *x) noexcept;
+    void rotate_right(rb_node *x) noexcept;
+    void replace_child(rb_node *parent, rb_node *old, rb_node *n) noexcept;
+    void insert_fixup(rb_node *n) noexcept;
+    void erase_fixup(rb_node *x, rb_node *parent) noexcept;
+    void propagate(rb_node *n) noexcept;
+public:
+    rb_tree(rb_augment_fn augment = nullptr) noexcept;
+
+    bool empty() const noexcept;
+    u64 size() const noexcept;
+    rb_node *top() const noexcept;
+    rb_node *first() const noexcept;
+    rb_node *last() const noexcept;
+
+    void erase(rb_node *n) noexcept;
+
+    /* less(a, b) orders the objects containing nodes a and b */
+    template<typename Less>
+    void
+    insert(rb_node *n, Less less) noexcept
+    {
+        rb_node **link = &root, *parent = nullptr;
+        bool is_leftmost = true;
+        while (*link) {
+            parent = *link;
+            if (less(n, parent)) {
+                link = &parent->left;
+            } else {
+                link = &parent->right;
+                is_leftmost = false;
+            }
+        }
+        n->parent = parent;
+        n->left = n->right = nullptr;
+        n->red = true;
+        *link = n;
+        if (is_leftmost)
+            leftmost = n;
+        nr_nodes++;
+        propagate(n);
+        insert_fixup(n);
+    }
+
+    static rb_node *next(const rb_node *n) noexcept;
+};
+#endif
@@ -0,0 +1,80 @@
+#ifndef SCHEDSIM_REACTOR_H
+#define SCHEDSIM_REACTOR_H
+
+#include <iostream>
+#include <queue>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <type_traits>
+#include <sys/types.h>
+#include <sys/sysinfo.h>
+#include "types.hpp"
+#include "task.hpp"
+#include "tasktable.hpp"
+#include "rr.hpp"
+
+#define REACTOR_STOP_FLAG   0x1
+#define REACTOR_STOP(flag)  ((flag) & REACTOR_STOP_FLAG)
+#define REACTOR_MAX_EVENTS  64
+
+namespace scheduler {
+/*
+ *  Event driven round robin engine. One pinned thread per cpu runs an
+ *  epoll loop over a pidfd per running task and a timerfd per dispatch
+ *  slot, so a single thread dispatches, preempts and reaps any number of
+ *  children without sleeping through a slice. Each loop drives `width`
+ *  concurrently running children (slots) using RR_TIMESLICE_US quanta.
+ */
+class reactor {
+private:
+    struct slot {
+        task                        *t;         // running task or nullptr
+        int                         tfd;        // slice deadline timer
+        time_point<steady_clock>    t_deadline; // absolute slice deadline
+    };
+
+    struct alignas(64) loop {
+        std::thread         thread;
+        int                 epfd;       // epoll instance
+        int                 evfd;       // wakeup for inbox / stop
+        std::vector<slot>   slots;      // dispatch slots
+        std::queue<task *>  ready;      // local run queue (loop thread only)
+        std::queue<task *>  inbox;      // tasks handed over by enqueue
+        std::mutex          inbox_mtx;  // lock for inbox
+        u32                 nr_running; // occupied slots
+    };
+
+    std::vector<loop>   loops;
+    std::atomic<u32>    next;       // round robin placement cursor
+    std::atomic<u8>     flag;
+
+    void dispatch(loop &l, u32 i, task *t) noexcept;
+    void preempt(loop &l, u32 i) noexcept;
+    void reap(loop &l, u32 i) noexcept;
+    void release(loop &l, u32 i) noexcept;
+    void run(loop &l) noexcept;
+public:
+    reactor(u32 ncpus = get_nprocs(), u32 width = 1) noexcept;
+    ~reactor() noexcept;
+
+    void enqueue(task *t) noexcept;
+
+    /*
+     *  Slab allocate new task pointer of derived type and hand it to the
+     *  next event loop in round robin order
+     */
+    template<typename T, typename... Args>
+    task *
+    enqueue(Args &&...args) noexcept
+    requires std::is_constructible_v<T, Args...> &&
+             std::is_base_of_v<task, T>
+    {
+        task *t = task_table::create<T>(std::forward<Args>(args)...);
+        enqueue(t);
+        return t;
+    }
+};
+} // namespace scheduler
+#endif
@@ -0,0 +1,43 @@
+#ifndef SCHEDSIM_REGISTRY_H
+#define SCHEDSIM_REGISTRY_H
+
+#include <mutex>
+#include <vector>
+
+/*
+ *  One T per thread: local() hands the calling thread an instance of its
+ *  own, allocated and registered on first use, so writers never share a
+ *  cache line, and readers visit every thread's instance under the lock.
+ *  Instances outlive their threads, as a thread may exit before its data
+ *  is read. The thread_local slot is per T, so keep a single registry of
+ *  any one type.
+ */
+template<typename T>
+class thread_registry {
+private:
+    std::vector<T *>    all;    // in order of first use
+    std::mutex          mtx;    // lock for all
+public:
+    T &
+    local() noexcept
+    {
+        thread_local T *t = nullptr;
+        if (!t) {
+            t = new T();
+            std::lock_guard<std::mutex> lk(mtx);
+            all.push_back(t);
+        }
+        return *t;
+    }
+
+    /* call f on the instance of every thread, oldest first */
+    template<typename F>
+    void
+    for_each(F &&f) noexcept
+    {
+        std::lock_guard<std::mutex> lk(mtx);
+        for (T *t : all)
+            f(*t);
+    }
+};
+#endif
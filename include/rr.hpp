@@ -6,6 +6,7 @@
 #include <vector>
 #include <thread>
 #include <semaphore>
+#include <atomic>
 #include <unistd.h>
 #include <type_traits>
 #include <sys/types.h>
@@ -13,19 +14,22 @@
 #include <cstdint>
 #include "types.hpp"
 #include "task.hpp"
+#include "tasktable.hpp"
+#include "mpmc.hpp"
 
 #define RR_TIMSLICE_MS  48
 #define RR_TIMESLICE_US 48000
 #define RR_STOP_FLAG    0x1
 #define RR_STOP(flag)   ((flag) & RR_STOP_FLAG)
+#define RR_QUEUE_CAP    4096    // ready queue capacity (power of two)
 
 namespace scheduler {
 class rr {
 private:
-    std::queue<task *>          tasks;
-    std::vector<std::thread>    threads;
-    std::binary_semaphore       sem; 
-    u8                          flag; 
+    mpmc_queue<task *, RR_QUEUE_CAP>    tasks;      // lock-free ready queue
+    std::vector<std::thread>            threads;
+    std::counting_semaphore<>           sem;        // parks idle workers
+    std::atomic<u8>                     flag; 
 
     void schedule(task *t) noexcept;
 public:
@@ -35,8 +39,9 @@ public:
     void enqueue(task *t) noexcept;
     
     /*
-     *  Heap allocate new task pointer of derived type and return the
-     *  pointer to the caller to manage deallocation
+     *  Slab allocate new task pointer of derived type and return the
+     *  pointer to the caller to manage deallocation. The task is pushed onto
+     *  the lock-free ready queue and one parked worker is woken for it
      */
     template<typename T, typename... Args>
     task *
@@ -44,10 +49,8 @@ public:
     requires std::is_constructible_v<T, Args...> && 
              std::is_base_of_v<task, T>
     {
-        task *t = new T(std::forward<Args>(args)...);
-        sem.acquire();
-        tasks.push(t);
-        sem.release();
+        task *t = task_table::create<T>(std::forward<Args>(args)...);
+        enqueue(t);
         return t;
     }
 };
@@ -7,9 +7,20 @@
 #include <unistd.h>
 #include "rr.hpp"
 #include "mlfq.hpp"
+#include "pmlfq.hpp"
+#include "reactor.hpp"
+#include "cfs.hpp"
+#include "eevdf.hpp"
+#include "stride.hpp"
+#include "srtf.hpp"
+#include "edf.hpp"
 #include "random.hpp"
 #include "metrics.hpp"
+#include "aggregator.hpp"
+#include "trace.hpp"
+#include "logger.hpp"
 #include "task.hpp"
+#include "tasktable.hpp"
 
 namespace scheduler {
 /* return number of currently available cpus on this system */
@@ -24,16 +35,18 @@ namespace scheduler {
 //     return (buf[2] - '0') * 10 + (buf[3] - '0') + 1;
 // }
 
+/*
+ *  Tasks are retired into the aggregator by the scheduler as they exit, so
+ *  nothing is kept here; metrics are complete once s has drained
+ */
 template<typename S, typename... Args>
 void 
 run(u32 runtime, Args &&...args) requires std::is_constructible_v<S, Args...>
 {
-    std::vector<task *> tasks;
-    tasks.reserve(100);
-
     struct timeval t_start, t_cur, t_end;
     gettimeofday(&t_start, nullptr);
     t_end.tv_sec = t_start.tv_sec + runtime;
+    aggregator::start();
     {
         S s(std::forward<Args>(args)...);
         for (u32 id = 0; ; ++id) {
@@ -42,21 +55,18 @@ run(u32 runtime, Args &&...args) requires std::is_constructible_v<S, Args...>
                 break;
 
             if (id % 2)
-                tasks.push_back(s.template enqueue<cpu_task>(id));
+                s.template enqueue<cpu_task>(id);
             else
-                tasks.push_back(s.template enqueue<mem_task>(id));
+                s.template enqueue<mem_task>(id);
 
             usleep(generator::rand<u32>(150000, 500000));
         }
     }
+    logger::flush();
+    trace::dump();
     std::cout << "\nSimulation exited. Obtaining scheduling metrics...\n";
-    metrics mt(tasks, t_start);
+    metrics mt = aggregator::finish();
     std::cout << mt << '\n';
-
-    /* cleanup */
-    for (task *t : tasks)
-        if (t)
-            delete t;
 }
 } // namespace scheduler
 #endif
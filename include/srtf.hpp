@@ -0,0 +1,93 @@
+#ifndef SCHEDSIM_SRTF_H
+#define SCHEDSIM_SRTF_H
+
+#include <iostream>
+#include <array>
+#include <queue>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <unordered_map>
+#include <type_traits>
+#include <pthread.h>
+#include <semaphore.h>
+#include <sys/sysinfo.h>
+#include "types.hpp"
+#include "task.hpp"
+#include "tasktable.hpp"
+#include "histogram.hpp"
+
+#define SRTF_QUANTUM_US     20000       // re-evaluate every 20 ms
+#define SRTF_EWMA_SHIFT     2           // a new observation weighs 1/4
+#define SRTF_INIT_PRED_US   1000000     // guess before a class has history
+#define SRTF_STOP_FLAG      0x1
+#define SRTF_STOP(flag)     ((flag) & SRTF_STOP_FLAG)
+
+/*
+ *  Online estimate of the cpu demand of each task class: an exponentially
+ *  weighted moving average of the cpu time (utime + stime from wait4) of
+ *  the class's finished tasks. Tasks never block from the scheduler's
+ *  point of view, so a task's whole demand is one burst.
+ */
+class runtime_predictor {
+private:
+    std::array<u64, 2>  pred;       // us, by task_kind
+    std::array<bool, 2> seeded;     // class has finished a task
+public:
+    static histogram    error;      // |predicted - actual| / actual, 1/1000
+
+    runtime_predictor() noexcept;
+
+    u64 total(task_kind kind) const noexcept;
+    u64 remaining(task_kind kind, u64 used) const noexcept;
+    void observe(task_kind kind, u64 predicted, u64 actual) noexcept;
+};
+
+namespace scheduler {
+/*
+ *  Shortest Remaining Time First: the task with the least predicted
+ *  remaining demand runs next, for SRTF_QUANTUM_US, after which the choice
+ *  is made again. Predicted remaining time is the class estimate minus
+ *  the cpu time a task has used, so within a class it is ordered by cpu
+ *  time alone: each class keeps a heap of its ready tasks by cpu time,
+ *  and a pick compares the two class heads against the current estimates.
+ */
+class srtf {
+private:
+    using ready_queue = std::priority_queue<task *, std::vector<task *>,
+                                            bool (*)(task *, task *)>;
+
+    runtime_predictor               pred;
+    std::array<ready_queue, 2>      ready;      // by task_kind
+    std::unordered_map<task *, u64> predicted;  // estimate at first run
+    pthread_mutex_t                 mtx;        // lock for the above
+    sem_t                           sem;        // queued tasks
+    std::vector<std::thread>        threads;
+    std::atomic<u8>                 flag;
+
+    static u64 used(const task *t) noexcept;
+    static bool less_used(task *a, task *b) noexcept;
+    task *pick() noexcept;
+    void schedule(task *t) noexcept;
+public:
+    srtf(u32 ncpus = get_nprocs()) noexcept;
+    ~srtf() noexcept;
+
+    void enqueue(task *t) noexcept;
+
+    /*
+     *  Slab allocate new task sub class constructed from argument list
+     *  and push it onto the ready heap of its class
+     */
+    template<typename T, typename... Args>
+    task *
+    enqueue(Args &&...args) noexcept
+    requires std::is_constructible_v<T, Args...> && std::is_base_of_v<task, T>
+    {
+        task *t = task_table::create<T>(std::forward<Args>(args)...);
+        enqueue(t);
+        return t;
+    }
+};
+} // namespace scheduler
+#endif
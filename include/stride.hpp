@@ -0,0 +1,272 @@
+#ifndef SCHEDSIM_STRIDE_H
+#define SCHEDSIM_STRIDE_H
+
+#include <iostream>
+#include <initializer_list>
+#include <vector>
+#include <random>
+#include <thread>
+#include <atomic>
+#include <type_traits>
+#include <pthread.h>
+#include <semaphore.h>
+#include <sys/sysinfo.h>
+#include "types.hpp"
+#include "task.hpp"
+#include "tasktable.hpp"
+#include "histogram.hpp"
+
+#define STRIDE1             (1 << 20)   // pass advance of 1us at 1 ticket
+#define STRIDE_QUANTUM_US   20000       // 20 ms quantum
+#define STRIDE_STOP_FLAG    0x1
+#define STRIDE_STOP(flag)   ((flag) & STRIDE_STOP_FLAG)
+#define STRIDE_GROUP_TICKETS 1000       // default funding of a group
+
+/* binary min-heap of pass values; elements track their position */
+template<typename T>
+class pass_heap {
+private:
+    std::vector<T *> heap;
+
+    void
+    place(u32 i, T *t) noexcept
+    {
+        heap[i] = t;
+        t->pos = i;
+    }
+
+    void
+    sift_up(u32 i) noexcept
+    {
+        T *t = heap[i];
+        while (i > 0) {
+            u32 parent = (i - 1) / 2;
+            if (heap[parent]->pass <= t->pass)
+                break;
+            place(i, heap[parent]);
+            i = parent;
+        }
+        place(i, t);
+    }
+
+    void
+    sift_down(u32 i) noexcept
+    {
+        T *t = heap[i];
+        u32 n = heap.size();
+        while (true) {
+            u32 child = 2 * i + 1;
+            if (child >= n)
+                break;
+            if (child + 1 < n && heap[child + 1]->pass < heap[child]->pass)
+                child++;
+            if (t->pass <= heap[child]->pass)
+                break;
+            place(i, heap[child]);
+            i = child;
+        }
+        place(i, t);
+    }
+public:
+    bool
+    empty() const noexcept
+    {
+        return heap.empty();
+    }
+
+    u64
+    size() const noexcept
+    {
+        return heap.size();
+    }
+
+    T *
+    top() const noexcept
+    {
+        return heap.front();
+    }
+
+    void
+    push(T *t) noexcept
+    {
+        heap.push_back(t);
+        sift_up(heap.size() - 1);
+    }
+
+    void
+    erase(T *t) noexcept
+    {
+        u32 i = t->pos;
+        T *last = heap.back();
+        heap.pop_back();
+        if (last == t)
+            return;
+        place(i, last);
+        update(last);
+    }
+
+    T *
+    pop() noexcept
+    {
+        T *t = heap.front();
+        erase(t);
+        return t;
+    }
+
+    /* restore heap order after t's pass changed */
+    void
+    update(T *t) noexcept
+    {
+        sift_up(t->pos);
+        sift_down(t->pos);
+    }
+};
+
+/*
+ *  Fenwick tree of queued clients' tickets, so a lottery draw finds the
+ *  winning client in O(log n). Clients keep their slot while queued
+ */
+class ticket_tree {
+private:
+    std::vector<u64>            sums;       // 1-based Fenwick array
+    std::vector<stride_client *> slots;
+    std::vector<u32>            free_slots;
+    u64                         total;
+
+    void add(u32 slot, i64 delta) noexcept;
+    void grow() noexcept;
+public:
+    ticket_tree() noexcept;
+
+    bool empty() const noexcept;
+    u64 get_total() const noexcept;
+    void insert(stride_client *c) noexcept;
+    void erase(stride_client *c) noexcept;
+    /* client owning ticket number r, 0 <= r < total */
+    stride_client *find(u64 r) const noexcept;
+};
+
+/*
+ *  Two-level proportional share run queue, not thread safe. Groups compete
+ *  with their tickets, then clients within the chosen group compete with
+ *  theirs. In stride mode the smallest pass wins at both levels; in
+ *  lottery mode a random ticket does. Moving tickets between groups only
+ *  rescales the groups' remaining pass, members are left untouched.
+ *
+ *  Entitlement: every us of service delivered is owed to the active
+ *  clients in proportion to their effective tickets. Each group keeps a
+ *  clock (gvt) of service owed per member ticket, so a client's
+ *  entitlement is its tickets times how far the clock moved while it was
+ *  active.
+ */
+class stride_queue {
+public:
+    struct group {
+        u64                         tickets;        // funding
+        u64                         member_tickets; // of active members
+        u32                         nr_active;      // active members
+        u32                         nr_queued;      // queued members
+        u64                         pass;           // virtual time
+        u64                         rem;
+        u64                         vtime;          // pass for joiners
+        u64                         vrem;
+        u64                         gvt;            // entitlement clock
+        u64                         gvt_rem;
+        u64                         t_used;         // service, us
+        u64                         t_entitled;     // entitled service, us
+        u64                         ent_rem;
+        u64                         t_used_mark;    // t_used at transfer
+        u64                         t_entitled_mark; // same, t_entitled
+        u32                         id;
+        u32                         pos;            // position in top heap
+        bool                        queued;         // in top heap
+        pass_heap<stride_client>    members;        // stride mode
+        ticket_tree                 lottery;        // lottery mode
+    };
+private:
+    std::vector<group>          groups;
+    pass_heap<group>            top;        // groups with queued members
+    u64                         tickets;    // funding of active groups
+    u64                         vtime;      // pass for rejoining groups
+    u64                         vrem;
+    u32                         nr_transfers;
+    bool                        lottery;
+    std::mt19937_64             rng;
+
+    void push(stride_client *c) noexcept;
+    void rescale(group &g, u64 new_tickets) noexcept;
+public:
+    histogram                   share;      // achieved/entitled x1000
+
+    /* one group per funding entry */
+    stride_queue(bool lottery, std::initializer_list<u64> funding) noexcept;
+
+    bool empty() const noexcept;
+    const std::vector<group> &get_groups() const noexcept;
+
+    void join(stride_client *c) noexcept;
+    void leave(stride_client *c, bool done) noexcept;
+    void requeue(stride_client *c) noexcept;
+    stride_client *pick() noexcept;
+    void charge(stride_client *c, u64 used) noexcept;
+    bool transfer(u32 from, u32 to, u64 amount) noexcept;
+
+    void report(std::ostream &os) const noexcept;
+};
+
+namespace scheduler {
+/*
+ *  Stride scheduler, or lottery scheduler with lottery = true: one shared
+ *  stride_queue behind a lock, served by one worker per cpu. Tasks are
+ *  grouped by kind; a task's tickets are its nice weight. xfer_tickets
+ *  are moved from the cpu bound to the memory bound group (back, if
+ *  negative) xfer_after s into the run.
+ */
+class stride {
+private:
+    struct share {
+        u32             task_id;
+        stride_client   sc;     // client state when the task exited
+    };
+
+    stride_queue                queue;
+    pthread_mutex_t             mtx;        // lock for queue
+    sem_t                       sem;        // queued tasks
+    std::vector<std::thread>    threads;
+    std::vector<task *>         seen;       // live tasks by client id
+    std::vector<share>          shares;     // by client id, for the report
+    std::atomic<u8>             flag;
+    std::atomic<i64>            xfer;       // pending transfer, 0: none
+    time_point<steady_clock>    t_xfer;     // when it is due
+    histogram                   t_pick;     // ns per scheduling decision
+
+    void schedule(task *t) noexcept;
+    void transfer_due() noexcept;
+public:
+    stride(u32 ncpus = get_nprocs(), bool lottery = false,
+           u64 cpu_tickets = STRIDE_GROUP_TICKETS,
+           u64 mem_tickets = STRIDE_GROUP_TICKETS,
+           i64 xfer_tickets = 0, u32 xfer_after = 0) noexcept;
+    ~stride() noexcept;
+
+    void enqueue(task *t) noexcept;
+    /* move amount tickets from group from to group to */
+    bool transfer(u32 from, u32 to, u64 amount) noexcept;
+
+    /*
+     *  Slab allocate new task sub class constructed from argument list
+     *  and join it to the group of its kind
+     */
+    template<typename T, typename... Args>
+    task *
+    enqueue(Args &&...args) noexcept
+    requires std::is_constructible_v<T, Args...> && std::is_base_of_v<task, T>
+    {
+        task *t = task_table::create<T>(std::forward<Args>(args)...);
+        t->get_sc()->group = std::is_same_v<T, cpu_task> ? 0 : 1;
+        enqueue(t);
+        return t;
+    }
+};
+} // namespace scheduler
+#endif
@@ -7,6 +7,20 @@
 #include <sys/types.h>
 #include <sys/resource.h>
 #include "types.hpp"
+#include "rbtree.hpp"
+#include "perfctr.hpp"
+
+#define CPU_TASK_PATH   "./bin/cpu_task"
+#define MEM_TASK_PATH   "./bin/mem_task"
+#define NICE_MIN        -20
+#define NICE_MAX        19
+#define NICE_0_WEIGHT   1024    // load weight of a nice 0 task
+#define TASK_NO_SLOT    UINT32_MAX  // not (yet) placed in the task table
+
+enum class task_kind : u8 {
+    CPU,        // cpu bound (cpu_task)
+    MEM         // memory bound (mem_task)
+};
 
 enum class task_state : char { 
     RUNNABLE    = 'r',
@@ -24,41 +38,133 @@ struct task_stat {
     time_point<high_resolution_clock>   t_firstrun;
     time_point<high_resolution_clock>   t_completion;
     time_point<high_resolution_clock>   t_laststop;
-    milliseconds                        t_waiting;
+    nanoseconds                         t_waiting;
+    nanoseconds                         t_reclaimed;
+    nanoseconds                         t_cpu;      // on a cpu, at last stop
+    nanoseconds                         t_rqdelay;  // on a kernel run queue
+    nanoseconds                         t_cpu_mark; // t_cpu when last marked
+    u64                                 win_epoch;  // snapshot window of
+    u64                                 win_cpu;    // the cpu us it got there
 
     task_stat() noexcept; 
-    milliseconds get_t_turnaround() const noexcept;
-    milliseconds get_t_response() const noexcept;
-    milliseconds get_t_waiting() const noexcept;
+    nanoseconds get_t_turnaround() const noexcept;
+    nanoseconds get_t_response() const noexcept;
+    nanoseconds get_t_waiting() const noexcept;
 };
 
+class task;
+
+/*
+ *  Per-task state of the fair schedulers, embedded in the task so queueing
+ *  it on a timeline never allocates
+ */
+struct sched_entity {
+    rb_node     run_node;       // position in a cpu timeline
+    task        *owner;         // task embedding this entity
+    u64         vruntime;       // weighted cpu time received, in ns
+    u64         deadline;       // virtual deadline of the current request
+    u64         min_deadline;   // earliest deadline in this subtree
+    i64         vlag;           // service owed when leaving a timeline
+    u32         weight;         // load weight derived from nice
+    i32         nice;           // NICE_MIN..NICE_MAX
+    i32         latency_nice;   // NICE_MIN..NICE_MAX, lower is shorter slices
+};
+
+/*
+ *  Per-task state of the proportional share schedulers. A client holds
+ *  tickets in the currency of its group; the group's own tickets decide
+ *  the share of the whole group. pass advances by STRIDE1 / tickets per us
+ *  of service, with the remainder carried in rem so no service is lost to
+ *  rounding however long the run.
+ */
+struct stride_client {
+    u64     pass;       // virtual time within the group
+    u64     rem;        // remainder of pass, in 1 / tickets units
+    u64     gvt_join;   // group entitlement clock when last joined
+    u64     t_used;     // service received, in us
+    u64     t_entitled; // service entitled to while active, in us
+    u32     tickets;    // tickets in group currency
+    u32     group;      // ticket group
+    u32     id;         // owner defined index
+    u32     pos;        // heap position (stride) or slot (lottery)
+    bool    active;     // joined and not yet left
+};
+
+/*
+ *  Per-task state of the deadline scheduler, one job at a time. Times are
+ *  steady_clock microseconds
+ */
+struct rt_entity {
+    u64     rel_deadline;   // deadline of each job after its release
+    u64     period;         // between job releases (0: a single job)
+    u64     budget;         // cpu time reserved for each job
+    u64     release;        // release of the current job
+    u64     deadline;       // absolute deadline of the current job
+    u64     t_cpu;          // cpu time of the task when the job released
+    u64     seq;            // FIFO order among equal deadlines
+};
+
+/*
+ *  A task lives in a slot of the task_table (see tasktable.hpp), which
+ *  keeps its hot fields, the state and pid, in arrays of their own; the
+ *  accessors below go through the slot index
+ */
 class task {
 protected:
-    struct rusage   *ru;        // resource usage 
-    task_stat       *stat;      // time tracking
-    pid_t           pid;        // process id
+    struct rusage   ru;         // resource usage 
+    task_stat       stat;       // time tracking
+    int             pidfd;      // process fd, opened on first use
+    mutable int     statfd;     // /proc/<pid>/stat, opened on first use
+    int             schedfd;    // /proc/<pid>/schedstat, same
+    perf_counters   pc;         // perf_event counters, opened at run()
     u32             task_id;    // program defined id 
-    task_state      state;      // task state
+    u32             slot;       // index in the task table
+    const task_kind kind;       // workload of the derived class
+    sched_entity    se;         // fair scheduler state
+    stride_client   sc;         // proportional share scheduler state
+    rt_entity       rt;         // deadline scheduler state
 public:
-    task(u32 id) noexcept;
+    task(u32 id, task_kind kind) noexcept;
     virtual ~task() noexcept;
     virtual void run() noexcept = 0;
+    task_kind get_kind() const noexcept;
+    u32 get_slot() const noexcept;
 
     task_state get_state() const noexcept;
+    task_state get_proc_state() const noexcept;
     void set_state(task_state new_state) noexcept;
 
     pid_t get_pid() const noexcept;
+    int get_pidfd() noexcept;
 
     u32 get_task_id() const noexcept;
 
-    struct rusage *get_rusage() const noexcept;
+    sched_entity *get_se() noexcept;
+    stride_client *get_sc() noexcept;
+    rt_entity *get_rt() noexcept;
+    i32 get_nice() const noexcept;
+    void set_nice(i32 nice) noexcept;
+    i32 get_latency_nice() const noexcept;
+    void set_latency_nice(i32 latency_nice) noexcept;
+
+    const struct rusage *get_rusage() const noexcept;
     void set_rusage(struct rusage *new_ru) noexcept;
     
     time_point<high_resolution_clock> get_t_start() const noexcept;
 
-    milliseconds get_t_turnaround() const noexcept;
-    milliseconds get_t_response() const noexcept;
-    milliseconds get_t_waiting() const noexcept;
+    nanoseconds get_t_turnaround() const noexcept;
+    nanoseconds get_t_response() const noexcept;
+    nanoseconds get_t_waiting() const noexcept;
+    nanoseconds get_t_reclaimed() const noexcept;
+    nanoseconds get_t_cpu() const noexcept;
+    nanoseconds get_t_rqdelay() const noexcept;
+
+    /* sample cpu time and counters after a stop; ru is what wait4 returned */
+    void account(const struct rusage *ru) noexcept;
+    const perf_counters &get_perf() const noexcept;
+    /* cpu time since the last mark_t_cpu(), e.g. at the current level */
+    nanoseconds get_t_cpu_since_mark() const noexcept;
+    void mark_t_cpu() noexcept;
 
     void
     set_t_completion(time_point<high_resolution_clock> t_completion)
@@ -75,9 +181,12 @@ public:
     void
     increment_t_waiting(time_point<high_resolution_clock> t_start) 
     noexcept;
+
+    void increment_t_reclaimed(nanoseconds t_unused) noexcept;
     
     friend std::ostream & 
     operator<<(std::ostream &os, const task &t);
+    friend class task_table;
 };
 
 class cpu_task : public task {
@@ -0,0 +1,81 @@
+#ifndef SCHEDSIM_TASKTABLE_H
+#define SCHEDSIM_TASKTABLE_H
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <sys/types.h>
+#include "types.hpp"
+#include "task.hpp"
+
+#define TASK_CHUNK_BITS 8
+#define TASK_CHUNK      (1U << TASK_CHUNK_BITS)    // slots per chunk
+#define TASK_MAX_CHUNKS 4096                        // up to 1M live tasks
+
+/*
+ *  Slab of task objects. Slots come in chunks of TASK_CHUNK, allocated as
+ *  needed and never moved, so a task's address is stable and a chunk is
+ *  found with one shift; freed slots are reused before the table grows.
+ *  Within a chunk the fields read on every dispatch (state, pid) are kept
+ *  in arrays of their own, apart from the task objects, so scanning them
+ *  touches a few cache lines rather than one per task. Lookups of state
+ *  and pid are lock free; creating and destroying tasks takes the lock.
+ */
+class task_table {
+private:
+    static constexpr size_t SLOT_SIZE =
+        std::max(sizeof(cpu_task), sizeof(mem_task));
+    static constexpr size_t SLOT_ALIGN =
+        std::max(alignof(cpu_task), alignof(mem_task));
+
+    struct alignas(SLOT_ALIGN) slot {
+        unsigned char   buf[SLOT_SIZE];
+    };
+
+    struct chunk {
+        task_state          state[TASK_CHUNK];  // tracked state
+        pid_t               pid[TASK_CHUNK];    // process id, 0 until run
+        task                *tasks[TASK_CHUNK]; // constructed task, if any
+        slot                objs[TASK_CHUNK];   // the task objects
+    };
+
+    static std::atomic<chunk *> chunks[TASK_MAX_CHUNKS];
+    static std::vector<u32>     free_slots;
+    static u32                  nr_slots;   // slots handed out so far
+    static u32                  nr_live;
+    static std::mutex           mtx;        // lock for the above
+
+    static chunk *chunk_of(u32 idx) noexcept;
+    static u32 alloc() noexcept;
+    static void *storage(u32 idx) noexcept;
+    static void bind(task *t, u32 idx) noexcept;
+public:
+    /*
+     *  Construct a T in a free slot; it starts out RUNNABLE without a
+     *  process. Replaces new T for every task the schedulers queue
+     */
+    template<typename T, typename... Args>
+    static T *
+    create(Args &&...args) noexcept
+    requires std::is_constructible_v<T, Args...> && std::is_base_of_v<task, T>
+    {
+        static_assert(sizeof(T) <= SLOT_SIZE && alignof(T) <= SLOT_ALIGN,
+                      "task type does not fit a task table slot");
+        u32 idx = alloc();
+        T *t = new (storage(idx)) T(std::forward<Args>(args)...);
+        bind(t, idx);
+        return t;
+    }
+
+    /* destroy a task made by create and free its slot */
+    static void destroy(task *t) noexcept;
+
+    static task_state &state(u32 idx) noexcept;
+    static pid_t &pid(u32 idx) noexcept;
+    static u32 size() noexcept;
+};
+#endif
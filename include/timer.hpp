@@ -0,0 +1,46 @@
+#ifndef SCHEDSIM_TIMER_H
+#define SCHEDSIM_TIMER_H
+
+#include <chrono>
+#include <sys/resource.h>
+#include "types.hpp"
+#include "task.hpp"
+#include "histogram.hpp"
+#include "latency.hpp"
+
+/*
+ *  Precise slice timer. The slice deadline is absolute (taken when the
+ *  timer is constructed, right after the task is started or resumed) and
+ *  is waited for on a per-thread TFD_TIMER_ABSTIME timerfd polled together
+ *  with the task's pidfd, so wakeup error does not accumulate and a task
+ *  that exits mid-slice ends the wait immediately. With a spin phase set,
+ *  the timerfd is armed spin_us early and the rest of the slice is spent
+ *  busy waiting on the clock, trading cpu time for deadline accuracy; the
+ *  pidfd is polled without blocking meanwhile, so an exit still ends it.
+ *
+ *  Every slice records how far past the requested length the task was
+ *  actually stopped (overshoot, per task class and per mlfq level, see
+ *  latency.hpp) and how long SIGSTOP took to be observed by wait4 (stop
+ *  latency, see overhead.hpp).
+ */
+class slice_timer {
+private:
+    time_point<steady_clock>    t_begin;    // slice start
+    time_point<steady_clock>    t_deadline; // absolute slice deadline
+    u32                         level;      // mlfq level, or LAT_NO_LEVEL
+    bool                        exited;     // task exited before deadline
+
+    static int                  tfd() noexcept;
+    static u32                  spin_us;    // busy wait before the deadline
+public:
+    slice_timer(u32 quantum_us, u32 level = LAT_NO_LEVEL) noexcept;
+
+    bool wait(task *t) noexcept;
+    int stop(task *t, struct rusage *ru) noexcept;
+
+    /* a task exited before t_deadline: credit the rest as reclaimed */
+    static void reclaim(task *t, time_point<steady_clock> t_deadline)
+    noexcept;
+    static void set_spin(u32 us) noexcept;
+};
+#endif
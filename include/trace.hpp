@@ -0,0 +1,61 @@
+#ifndef SCHEDSIM_TRACE_H
+#define SCHEDSIM_TRACE_H
+
+#include <array>
+#include <atomic>
+#include "types.hpp"
+#include "registry.hpp"
+
+#define TRACE_RING_BITS 16
+#define TRACE_RING      (1U << TRACE_RING_BITS)    // events kept per thread
+
+enum class trace_type : u8 {
+    DISPATCH,   // a slice begins; arg: level
+    PREEMPT,    // the slice ended and the task was stopped; arg: level
+    DEMOTE,     // the task moves down; arg: its new level
+    BOOST,      // all queued tasks were boosted to the top level
+    EXIT,       // the task exited during its slice; arg: level
+    STEAL       // the task was taken from another cpu; arg: the victim
+};
+
+struct trace_event {
+    u64         ts;     // steady_clock ns
+    u32         task;   // task id, 0 for BOOST
+    u16         arg;
+    trace_type  type;
+};
+
+/*
+ *  Scheduler event trace. Every thread that emits gets a ring of its own
+ *  which only it writes, so recording is a store and a release of the
+ *  head; once full, the oldest events are overwritten. After the workers
+ *  are joined, dump() writes all rings as Chrome trace JSON (also read by
+ *  Perfetto), one track per worker: each slice from dispatch to preempt
+ *  or exit is a span, demotions, boosts and steals are instants.
+ *
+ *  Call sites use TRACE(), which compiles to nothing unless the build
+ *  defines SCHEDSIM_TRACE (make TRACE=1); at run time, -t FILE enables it.
+ */
+class trace {
+private:
+    struct ring {
+        std::array<trace_event, TRACE_RING> buf;
+        std::atomic<u64>                    head;   // events written
+    };
+
+    static thread_registry<ring>    rings;      // track n: n-th ring
+    static const char               *path;      // output, nullptr: disabled
+    static std::atomic<bool>        on;
+public:
+    static void emit(trace_type type, u32 task, u16 arg) noexcept;
+    static void set_path(const char *p) noexcept;
+    /* write every ring to the output path; workers must be quiescent */
+    static void dump() noexcept;
+};
+
+#ifdef SCHEDSIM_TRACE
+#define TRACE(type, task, arg) trace::emit(trace_type::type, (task), (arg))
+#else
+#define TRACE(type, task, arg) ((void)0)
+#endif
+#endif
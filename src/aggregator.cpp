@@ -0,0 +1,154 @@
+/* aggregator.cpp Online Metrics of a Live Run */
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <sys/sysinfo.h>
+#include "../include/types.hpp"
+#include "../include/task.hpp"
+#include "../include/tasktable.hpp"
+#include "../include/cpuacct.hpp"
+#include "../include/metrics.hpp"
+#include "../include/latency.hpp"
+#include "../include/aggregator.hpp"
+
+metrics                     aggregator::totals;
+std::atomic<u64>            aggregator::nr_retired(0);
+u32                         aggregator::interval = AGG_INTERVAL_S;
+time_point<steady_clock>    aggregator::t_start;
+std::mutex                  aggregator::mtx;
+std::condition_variable     aggregator::cv;
+std::thread                 aggregator::reporter;
+bool                        aggregator::stop = false;
+std::atomic<u64>            aggregator::epoch(0);
+std::atomic<double>         aggregator::win_sum[AGG_WINDOWS];
+std::atomic<double>         aggregator::win_sum_sq[AGG_WINDOWS];
+
+/*
+ *  Background thread: every interval, print the tasks finished per second,
+ *  the cpu time accounted to tasks as a share of all cpus, the tasks
+ *  alive and the fairness of the window closed an interval earlier. The
+ *  line is written in one piece so it is not torn by the schedulers' own
+ *  output
+ */
+void
+aggregator::report() noexcept
+{
+    const u32 ncpus = get_nprocs();
+    u64 last_retired = 0, last_cpu = cpuacct::t_accounted.load();
+    u64 last_n = 0;     // tasks alive in the window read next
+    auto last = steady_clock::now();
+
+    std::unique_lock<std::mutex> lk(mtx);
+    while (!cv.wait_for(lk, seconds(interval), []{ return stop; })) {
+        auto now = steady_clock::now();
+        u64 retired = nr_retired.load(), cpu = cpuacct::t_accounted.load();
+        double secs = duration<double>(now - last).count();
+        double up = duration<double>(now - t_start).count();
+
+        /*
+         *  Close window e, whose samples are every task alive in it, and
+         *  read window e - 1, which late charges have had an interval to
+         *  reach. Slot e + 2 was read a tick ago and is charged from the
+         *  next tick on, so it is cleared now
+         */
+        u64 e = epoch.load();
+        win_sum[(e + 2) % AGG_WINDOWS] = 0;
+        win_sum_sq[(e + 2) % AGG_WINDOWS] = 0;
+        epoch.store(e + 1);
+        u32 live = task_table::size();
+        char fair[16] = "-";
+        if (e > 0)
+            snprintf(fair, sizeof(fair), "%.3f", metrics::jain(
+                win_sum[(e - 1) % AGG_WINDOWS],
+                win_sum_sq[(e - 1) % AGG_WINDOWS], last_n
+            ));
+        last_n = live + (retired - last_retired);
+
+        char line[128];
+        snprintf(line, sizeof(line),
+                 "[%7.1fs] %.2f tasks/s, %.1f%% cpu, %u live, %lu done, "
+                 "fairness %s\n",
+                 up, (retired - last_retired) / secs,
+                 (cpu - last_cpu) / (secs * 1e9 * ncpus) * 100,
+                 live, retired, fair);
+        std::cout << line << std::flush;
+
+        last = now;
+        last_retired = retired;
+        last_cpu = cpu;
+    }
+}
+
+void
+aggregator::set_interval(u32 secs) noexcept
+{
+    interval = secs;
+}
+
+void
+aggregator::start() noexcept
+{
+    totals = metrics();
+    nr_retired = 0;
+    stop = false;
+    epoch = 0;
+    for (u32 i = 0; i < AGG_WINDOWS; ++i)
+        win_sum[i] = win_sum_sq[i] = 0;
+    t_start = steady_clock::now();
+    if (interval)
+        reporter = std::thread(report);
+}
+
+void
+aggregator::charge(task_stat &s, nanoseconds d) noexcept
+{
+    if (!interval)
+        return;
+    u64 e = epoch.load(std::memory_order_relaxed);
+    if (s.win_epoch != e) {
+        s.win_epoch = e;
+        s.win_cpu = 0;
+    }
+    double a = s.win_cpu, x = duration_cast<microseconds>(d).count();
+    win_sum[e % AGG_WINDOWS].fetch_add(x, std::memory_order_relaxed);
+    win_sum_sq[e % AGG_WINDOWS].fetch_add(2 * a * x + x * x,
+                                          std::memory_order_relaxed);
+    s.win_cpu += duration_cast<microseconds>(d).count();
+}
+
+void
+aggregator::retire(task *t) noexcept
+{
+    task_kind k = t->get_kind();
+    latency::record(lat_metric::TURNAROUND, k, t->get_t_turnaround().count());
+    latency::record(lat_metric::RESPONSE, k, t->get_t_response().count());
+    latency::record(lat_metric::WAITING, k, t->get_t_waiting().count());
+    {
+        std::lock_guard<std::mutex> lk(mtx);
+        totals.add(t);
+    }
+    nr_retired.fetch_add(1, std::memory_order_relaxed);
+    task_table::destroy(t);
+}
+
+metrics
+aggregator::finish() noexcept
+{
+    {
+        std::lock_guard<std::mutex> lk(mtx);
+        stop = true;
+    }
+    cv.notify_all();
+    if (reporter.joinable())
+        reporter.join();
+
+    metrics m = totals;
+    m.finalize(duration<double, std::milli>(
+        steady_clock::now() - t_start
+    ).count(), get_nprocs());
+    return m;
+}
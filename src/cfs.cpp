@@ -0,0 +1,223 @@
+/* cfs.cpp Completely Fair Scheduler */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <sys/sysinfo.h>
+#include <sys/types.h>
+#include <signal.h>
+#include <err.h>
+#include "../include/types.hpp"
+#include "../include/task.hpp"
+#include "../include/aggregator.hpp"
+#include "../include/logger.hpp"
+#include "../include/overhead.hpp"
+#include "../include/rbtree.hpp"
+#include "../include/timer.hpp"
+#include "../include/cfs.hpp"
+
+namespace scheduler {
+static bool
+vruntime_less(const rb_node *a, const rb_node *b) noexcept
+{
+    return rb_entry(a, sched_entity, run_node)->vruntime <
+           rb_entry(b, sched_entity, run_node)->vruntime;
+}
+
+/* caller holds rq.mtx */
+void
+cfs::insert(runqueue &rq, sched_entity *se) noexcept
+{
+    rq.timeline.insert(&se->run_node, vruntime_less);
+    rq.load += se->weight;
+    rq.nr_peak = std::max(rq.nr_peak, rq.timeline.size());
+    rq.nr_queued++;
+}
+
+/*
+ *  Take the leftmost task off the timeline and compute its slice: its
+ *  weighted share of the period among all tasks runnable on this cpu
+ */
+sched_entity *
+cfs::pick(runqueue &rq, u64 *slice) noexcept
+{
+    lock(rq, &rq.t_lockwait);
+    rb_node *n = rq.timeline.first();
+    if (!n) {
+        pthread_mutex_unlock(&rq.mtx);
+        return nullptr;
+    }
+    rq.timeline.erase(n);
+    rq.nr_queued--;
+    sched_entity *se = rb_entry(n, sched_entity, run_node);
+    rq.load -= se->weight;
+    rq.min_vruntime = std::max(rq.min_vruntime, se->vruntime);
+
+    u64 nr_running = rq.timeline.size() + 1;
+    u64 period = nr_running > CFS_NR_LATENCY ?
+                 nr_running * CFS_MIN_GRAN_NS : CFS_LATENCY_NS;
+    *slice = std::max<u64>(period * se->weight / (rq.load + se->weight),
+                           CFS_MIN_GRAN_NS);
+    pthread_mutex_unlock(&rq.mtx);
+    return se;
+}
+
+/*
+ *  Move the leftmost task of the cpu with the most queued tasks onto our
+ *  own timeline, keeping its distance to min_vruntime
+ */
+bool
+cfs::pull(runqueue &self) noexcept
+{
+    runqueue *busiest = nullptr;
+    u32 nr_max = 0;
+    for (u32 i = 1; i < ncpus; ++i) {
+        runqueue &rq = rqs[(self.cpu + i) % ncpus];
+        u32 nr = rq.nr_queued.load();
+        if (nr > nr_max) {
+            nr_max = nr;
+            busiest = &rq;
+        }
+    }
+    if (!busiest)
+        return false;
+
+    lock(*busiest, &self.t_lockwait);
+    rb_node *n = busiest->timeline.first();
+    if (!n) {
+        pthread_mutex_unlock(&busiest->mtx);
+        return false;
+    }
+    busiest->timeline.erase(n);
+    busiest->nr_queued--;
+    sched_entity *se = rb_entry(n, sched_entity, run_node);
+    busiest->load -= se->weight;
+    u64 lag = se->vruntime - std::min(se->vruntime, busiest->min_vruntime);
+    pthread_mutex_unlock(&busiest->mtx);
+
+    lock(self, &self.t_lockwait);
+    se->vruntime = self.min_vruntime + lag;
+    insert(self, se);
+    pthread_mutex_unlock(&self.mtx);
+    self.nr_pulls++;
+    return true;
+}
+
+void
+cfs::push(runqueue &rq, task *t, u64 *t_wait) noexcept
+{
+    sched_entity *se = t->get_se();
+    lock(rq, t_wait);
+    se->vruntime = std::max(se->vruntime, rq.min_vruntime);
+    insert(rq, se);
+    pthread_mutex_unlock(&rq.mtx);
+    wake(rq);
+}
+
+void
+cfs::schedule(runqueue &self, task *t, u64 slice) noexcept
+{
+    sched_entity *se = t->get_se();
+    struct rusage cur;
+
+    OVERHEAD_START(t_dequeue);
+    switch (t->get_state()) {
+    case task_state::RUNNABLE:
+        t->set_t_firstrun(high_resolution_clock::now());
+        t->run();
+        LOG(INFO, STARTED, t, 0);
+        break;
+    case task_state::STOPPED:
+        t->increment_t_waiting(high_resolution_clock::now());
+        kill(t->get_pid(), SIGCONT);
+        break;
+    default:
+        err(EXIT_FAILURE, "unexpected task state");
+    }
+    t->set_state(task_state::RUNNING);
+    OVERHEAD_SINCE(DISPATCH, t_dequeue);
+
+    /*
+     *  let task run for its slice, or until it exits, and charge the cpu
+     *  time it actually used rather than the wall clock of the slice
+     */
+    nanoseconds c0 = t->get_t_cpu();
+    slice_timer st(slice / 1000);
+    st.wait(t);
+    int wstat = st.stop(t, &cur);
+    u64 delta = (t->get_t_cpu() - c0).count();
+    se->vruntime += delta * NICE_0_WEIGHT / se->weight;
+    t->set_rusage(&cur);
+
+    if (WIFEXITED(wstat)) {
+        assert(WEXITSTATUS(wstat) == 0);
+        t->set_state(task_state::FINISHED);
+        t->set_t_completion(high_resolution_clock::now());
+
+        LOG(INFO, EXITED, t, 0);
+        aggregator::retire(t);
+    } else if (WIFSTOPPED(wstat) && WSTOPSIG(wstat) == SIGSTOP) {
+        t->set_state(task_state::STOPPED);
+        t->set_t_laststop(high_resolution_clock::now());
+        push(self, t, &self.t_lockwait);
+        kick(self);
+    }
+}
+
+/* run the leftmost task of self, or pull one from the busiest cpu */
+bool
+cfs::dispatch(runqueue &self) noexcept
+{
+    u64 slice;
+    if (sched_entity *se = pick(self, &slice)) {
+        self.nr_dispatch++;
+        schedule(self, se->owner, slice);
+        return true;
+    }
+    return pull(self);
+}
+
+cfs::cfs(u32 ncpus, i32 mem_nice) noexcept
+    : percpu(ncpus, CFS_IDLE_WAIT_US),
+      mem_nice(mem_nice)
+{
+    for (u32 i = 0; i < ncpus; ++i) {
+        rqs[i].load = 0;
+        rqs[i].min_vruntime = 0;
+        rqs[i].nr_pulls = 0;
+        rqs[i].nr_peak = 0;
+    }
+    start();
+}
+
+/* join all threads and report per-cpu statistics */
+cfs::~cfs() noexcept
+{
+    stop();
+
+    u64 nr_pulls = 0, nr_peak = 0;
+    report("CFS", [&](const runqueue &rq) {
+        std::cout << rq.nr_pulls << " pulls, "
+                  << rq.nr_peak << " peak queued, ";
+        nr_pulls += rq.nr_pulls;
+        nr_peak = std::max(nr_peak, rq.nr_peak);
+    }, [&] {
+        std::cout << "Total Pulls:\t\t\t\t" << nr_pulls << '\n'
+                  << "Peak Timeline Length:\t\t\t" << nr_peak << '\n';
+    });
+}
+
+void
+cfs::enqueue(task *t) noexcept
+{
+    push(place(true), t, nullptr);
+}
+} // namespace scheduler
@@ -2,11 +2,17 @@
 #include <random>
 #include <algorithm>
 #include <cstdlib>
+#include <csignal>
 #include <cassert>
+#include "../include/launcher.hpp"
 
 int
 main(int argc, char *argv[])
 {
+    /* launched as a pre-exec'd child: wait for the scheduler to start us */
+    if (getenv(LAUNCH_STOPPED_ENV))
+        raise(SIGSTOP);
+
     std::random_device rd;
     std::mt19937 gen(rd());
     std::uniform_real_distribution<> dist(-1024.0f, 1024.0f);
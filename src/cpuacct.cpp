@@ -0,0 +1,78 @@
+/* cpuacct.cpp Nanosecond CPU Accounting of Task Processes */
+#include <atomic>
+#include <cstdio>
+#include <cinttypes>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/resource.h>
+#include "../include/types.hpp"
+#include "../include/cpuacct.hpp"
+
+std::atomic<bool> cpuacct::no_schedstat(false);
+std::atomic<u64> cpuacct::t_accounted(0);
+
+bool
+cpuacct::sample(pid_t pid, int *fd, cpu_sample *s) noexcept
+{
+    if (!no_schedstat.load(std::memory_order_relaxed)) {
+        char buf[96];
+        if (*fd < 0) {
+            char path[32];
+            snprintf(path, sizeof(path), "/proc/%d/schedstat", pid);
+            *fd = open(path, O_RDONLY | O_CLOEXEC);
+        }
+        if (*fd >= 0) {
+            ssize_t n = pread(*fd, buf, sizeof(buf) - 1, 0);
+            if (n < 0)
+                return false;   // reaped since the fd was opened
+            if (n > 0) {
+                buf[n] = '\0';
+                if (sscanf(buf, "%" SCNu64 " %" SCNu64,
+                           &s->t_cpu, &s->t_delay) == 2)
+                    return true;
+            }
+            /* the file exists but is not in the expected format */
+            no_schedstat.store(true, std::memory_order_relaxed);
+        } else if (access("/proc/self/schedstat", R_OK) != 0) {
+            no_schedstat.store(true, std::memory_order_relaxed);
+        } else {
+            return false;   // no such process
+        }
+    }
+
+    clockid_t cid;
+    struct timespec ts;
+    if (clock_getcpuclockid(pid, &cid) != 0 || clock_gettime(cid, &ts) != 0)
+        return false;
+    s->t_cpu = (u64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+    s->t_delay = 0;
+    return true;
+}
+
+u64
+cpuacct::rusage_ns(const struct rusage *ru) noexcept
+{
+    return ((u64)(ru->ru_utime.tv_sec + ru->ru_stime.tv_sec) * 1000000 +
+            ru->ru_utime.tv_usec + ru->ru_stime.tv_usec) * 1000;
+}
+
+cpuacct_source
+cpuacct::source() noexcept
+{
+    return no_schedstat.load() ? cpuacct_source::CPUCLOCK
+                               : cpuacct_source::SCHEDSTAT;
+}
+
+const char *
+cpuacct::name(cpuacct_source src) noexcept
+{
+    switch (src) {
+    case cpuacct_source::SCHEDSTAT:
+        return "schedstat";
+    case cpuacct_source::CPUCLOCK:
+        return "cpu clock";
+    }
+    return "unknown";
+}
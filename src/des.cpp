@@ -0,0 +1,488 @@
+/* des.cpp Discrete-Event Simulation Engine */
+#include <iostream>
+#include <algorithm>
+#include <array>
+#include <deque>
+#include <queue>
+#include <vector>
+#include <functional>
+#include "../include/types.hpp"
+#include "../include/task.hpp"
+#include "../include/random.hpp"
+#include "../include/metrics.hpp"
+#include "../include/rr.hpp"
+#include "../include/mlfq.hpp"
+#include "../include/stride.hpp"
+#include "../include/srtf.hpp"
+#include "../include/des.hpp"
+
+namespace des {
+void
+rr_policy::enqueue(std::vector<vtask> &, u32 idx) noexcept
+{
+    ready.push_back(idx);
+}
+
+bool
+rr_policy::pick(std::vector<vtask> &, u32 &idx) noexcept
+{
+    if (ready.empty())
+        return false;
+    idx = ready.front();
+    ready.pop_front();
+    return true;
+}
+
+u64
+rr_policy::quantum(const vtask &) const noexcept
+{
+    return RR_TIMESLICE_US;
+}
+
+void
+rr_policy::preempted(std::vector<vtask> &, u32 idx, u64) noexcept
+{
+    ready.push_back(idx);
+}
+
+u64
+rr_policy::boost_period() const noexcept
+{
+    return 0;
+}
+
+void
+rr_policy::boost(std::vector<vtask> &) noexcept
+{}
+
+void
+rr_policy::charge(std::vector<vtask> &, u32, u64) noexcept
+{}
+
+void
+rr_policy::leave(std::vector<vtask> &, u32, bool) noexcept
+{}
+
+void
+rr_policy::report() const noexcept
+{}
+
+template<u32 N, typename Q>
+void
+basic_mlfq_policy<N, Q>::enqueue(std::vector<vtask> &tasks, u32 idx)
+noexcept
+{
+    ready.push(idx, tasks[idx].level);
+}
+
+template<u32 N, typename Q>
+bool
+basic_mlfq_policy<N, Q>::pick(std::vector<vtask> &tasks, u32 &idx) noexcept
+{
+    u32 lvl;
+    if (!ready.pop(&idx, &lvl))
+        return false;
+    /* a task queued before a boost is promoted here */
+    tasks[idx].level = lvl;
+    return true;
+}
+
+template<u32 N, typename Q>
+u64
+basic_mlfq_policy<N, Q>::quantum(const vtask &t) const noexcept
+{
+    return Q::us(t.level);
+}
+
+/* a task is only preempted after using its whole slice: demote it */
+template<u32 N, typename Q>
+void
+basic_mlfq_policy<N, Q>::preempted(std::vector<vtask> &tasks, u32 idx, u64)
+noexcept
+{
+    vtask &t = tasks[idx];
+    if (t.level < N - 1)
+        t.level++;
+    ready.push(idx, t.level);
+}
+
+template<u32 N, typename Q>
+u64
+basic_mlfq_policy<N, Q>::boost_period() const noexcept
+{
+    return PRIOBOOSTFREQ_US;
+}
+
+template<u32 N, typename Q>
+void
+basic_mlfq_policy<N, Q>::boost(std::vector<vtask> &) noexcept
+{
+    ready.boost();
+}
+
+template<u32 N, typename Q>
+void
+basic_mlfq_policy<N, Q>::charge(std::vector<vtask> &, u32, u64)
+noexcept
+{}
+
+template<u32 N, typename Q>
+void
+basic_mlfq_policy<N, Q>::leave(std::vector<vtask> &, u32, bool)
+noexcept
+{}
+
+template<u32 N, typename Q>
+void
+basic_mlfq_policy<N, Q>::report() const noexcept
+{}
+
+template class basic_mlfq_policy<>;
+template class basic_mlfq_policy<64, linear_quantum<5000, 320000>>;
+template class basic_mlfq_policy<140, linear_quantum<2000, 280000>>;
+
+stride_policy::stride_policy(bool lottery) noexcept
+    : queue(lottery, { STRIDE_GROUP_TICKETS, STRIDE_GROUP_TICKETS })
+{}
+
+stride_policy::stride_policy() noexcept
+    : stride_policy(false)
+{}
+
+lottery_policy::lottery_policy() noexcept
+    : stride_policy(true)
+{}
+
+/* arrivals get a fresh client, tasks back from I/O rejoin with theirs */
+void
+stride_policy::enqueue(std::vector<vtask> &tasks, u32 idx) noexcept
+{
+    if (idx >= clients.size())
+        clients.resize(idx + 1);
+    stride_client &c = clients[idx];
+    if (!tasks[idx].started) {
+        c = {};
+        c.tickets = generator::rand<u32>(DES_STRIDE_TICKETS_LO,
+                                         DES_STRIDE_TICKETS_HI);
+        c.group = tasks[idx].kind == task_kind::CPU ? 0 : 1;
+        c.id = idx;
+    }
+    queue.join(&c);
+}
+
+bool
+stride_policy::pick(std::vector<vtask> &, u32 &idx) noexcept
+{
+    auto t0 = steady_clock::now();
+    stride_client *c = queue.pick();
+    t_pick.record(duration_cast<nanoseconds>(
+        steady_clock::now() - t0
+    ).count());
+    if (!c)
+        return false;
+    idx = c->id;
+    return true;
+}
+
+u64
+stride_policy::quantum(const vtask &) const noexcept
+{
+    return STRIDE_QUANTUM_US;
+}
+
+void
+stride_policy::preempted(std::vector<vtask> &, u32 idx, u64) noexcept
+{
+    queue.requeue(&clients[idx]);
+}
+
+u64
+stride_policy::boost_period() const noexcept
+{
+    return 0;
+}
+
+void
+stride_policy::boost(std::vector<vtask> &) noexcept
+{}
+
+void
+stride_policy::charge(std::vector<vtask> &, u32 idx, u64 used) noexcept
+{
+    queue.charge(&clients[idx], used);
+}
+
+void
+stride_policy::leave(std::vector<vtask> &, u32 idx, bool done) noexcept
+{
+    queue.leave(&clients[idx], done);
+}
+
+void
+stride_policy::report() const noexcept
+{
+    std::cout << '\n';
+    queue.report(std::cout);
+    std::cout << "Pick Overhead (p50/p99/max):\t\t"
+              << t_pick.percentile(50) << '/' << t_pick.percentile(99) << '/'
+              << t_pick.max() << "ns\n";
+}
+
+/* arrivals are predicted the current estimate of their kind */
+void
+srtf_policy::enqueue(std::vector<vtask> &tasks, u32 idx) noexcept
+{
+    const vtask &t = tasks[idx];
+    if (!t.started) {
+        if (idx >= predicted.size())
+            predicted.resize(idx + 1);
+        predicted[idx] = pred.total(t.kind);
+    }
+    ready[(u32)t.kind].push({ t.t_cpu, seq++, idx });
+}
+
+bool
+srtf_policy::pick(std::vector<vtask> &, u32 &idx) noexcept
+{
+    auto &cpu = ready[(u32)task_kind::CPU];
+    auto &mem = ready[(u32)task_kind::MEM];
+    std::priority_queue<entry> *q;
+    if (cpu.empty() && mem.empty())
+        return false;
+    if (cpu.empty())
+        q = &mem;
+    else if (mem.empty())
+        q = &cpu;
+    else
+        q = pred.remaining(task_kind::CPU, cpu.top().used) <
+            pred.remaining(task_kind::MEM, mem.top().used) ? &cpu : &mem;
+    idx = q->top().idx;
+    q->pop();
+    return true;
+}
+
+u64
+srtf_policy::quantum(const vtask &) const noexcept
+{
+    return SRTF_QUANTUM_US;
+}
+
+void
+srtf_policy::preempted(std::vector<vtask> &tasks, u32 idx, u64) noexcept
+{
+    enqueue(tasks, idx);
+}
+
+u64
+srtf_policy::boost_period() const noexcept
+{
+    return 0;
+}
+
+void
+srtf_policy::boost(std::vector<vtask> &) noexcept
+{}
+
+void
+srtf_policy::charge(std::vector<vtask> &, u32, u64) noexcept
+{}
+
+void
+srtf_policy::leave(std::vector<vtask> &tasks, u32 idx, bool done) noexcept
+{
+    if (done)
+        pred.observe(tasks[idx].kind, predicted[idx], tasks[idx].t_cpu);
+}
+
+void
+srtf_policy::report() const noexcept
+{
+    std::cout << "\nRuntime Estimates:\n"
+              << "\tCPU Bound Tasks:\t"
+              << pred.total(task_kind::CPU) / 1e3 << "ms\n"
+              << "\tMemory Bound Tasks:\t"
+              << pred.total(task_kind::MEM) / 1e3 << "ms\n";
+}
+
+enum class ev_type : u8 {
+    ARRIVAL,        // next task enters the system
+    SLICE_END,      // a cpu's current slice ends (quantum, exit or I/O)
+    IO_DONE,        // a blocked task becomes runnable again
+    BOOST           // periodic policy event (priority boost)
+};
+
+struct event {
+    u64     t;
+    u64     seq;    // FIFO order among events at the same time
+    ev_type type;
+    u32     arg;    // cpu for SLICE_END, task index for IO_DONE
+
+    bool
+    operator>(const event &e) const noexcept
+    {
+        return t != e.t ? t > e.t : seq > e.seq;
+    }
+};
+
+struct vcpu {
+    u32     idx;        // running task
+    u64     quantum;    // slice granted
+    u64     len;        // slice actually run (until exit or I/O if sooner)
+};
+
+template<typename P>
+void
+run(u64 ntasks, u32 ncpus) noexcept
+{
+    P policy;
+    metrics m;
+    std::vector<vtask> tasks;
+    std::vector<u32> freelist, idle;
+    std::vector<vcpu> cpus(ncpus);
+    std::priority_queue<event, std::vector<event>, std::greater<event>> evq;
+    u64 now = 0, t_end = 0, seq = 0, arrived = 0, finished = 0;
+
+    for (u32 c = ncpus; c-- > 0; )
+        idle.push_back(c);
+
+    auto post = [&](u64 t, ev_type type, u32 arg) {
+        evq.push({ t, seq++, type, arg });
+    };
+
+    /* hand the next task chosen by the policy to cpu c */
+    auto dispatch = [&](u32 c) -> bool {
+        u32 idx;
+        if (!policy.pick(tasks, idx))
+            return false;
+        vtask &t = tasks[idx];
+        if (!t.started) {
+            t.started = true;
+            t.t_firstrun = now;
+            t.t_waiting += now - t.t_arrival;
+        } else {
+            t.t_waiting += now - t.t_laststop;
+        }
+        u64 q = policy.quantum(t);
+        u64 len = std::min(q, t.service);
+        if (t.burst)
+            len = std::min(len, t.burst_left);
+        cpus[c] = { idx, q, len };
+        post(now + len, ev_type::SLICE_END, c);
+        return true;
+    };
+
+    auto kick = [&] {
+        while (!idle.empty() && dispatch(idle.back()))
+            idle.pop_back();
+    };
+
+    post(0, ev_type::ARRIVAL, 0);
+    if (policy.boost_period())
+        post(policy.boost_period(), ev_type::BOOST, 0);
+
+    auto t_wall = steady_clock::now();
+    while (!evq.empty()) {
+        event e = evq.top();
+        evq.pop();
+        now = e.t;
+
+        switch (e.type) {
+        case ev_type::ARRIVAL: {
+            u32 idx;
+            if (!freelist.empty()) {
+                idx = freelist.back();
+                freelist.pop_back();
+            } else {
+                idx = tasks.size();
+                tasks.emplace_back();
+            }
+            vtask &t = tasks[idx];
+            t = {};
+            t.id = arrived;
+            t.kind = (arrived % 2) ? task_kind::CPU : task_kind::MEM;
+            t.t_arrival = now;
+            if (t.kind == task_kind::CPU) {
+                t.service = generator::rand<u64>(DES_CPU_SERVICE_LO,
+                                                 DES_CPU_SERVICE_HI);
+            } else {
+                t.service = generator::rand<u64>(DES_MEM_SERVICE_LO,
+                                                 DES_MEM_SERVICE_HI);
+                t.burst = generator::rand<u64>(DES_MEM_BURST_LO,
+                                               DES_MEM_BURST_HI);
+                t.burst_left = t.burst;
+                t.io = generator::rand<u64>(DES_MEM_IO_LO, DES_MEM_IO_HI);
+            }
+            policy.enqueue(tasks, idx);
+            if (++arrived < ntasks)
+                post(now + generator::rand<u64>(DES_ARRIVAL_LO,
+                                                DES_ARRIVAL_HI) *
+                           DES_ARRIVAL_CPUS / ncpus,
+                     ev_type::ARRIVAL, 0);
+            kick();
+            break;
+        }
+        case ev_type::SLICE_END: {
+            vcpu &c = cpus[e.arg];
+            vtask &t = tasks[c.idx];
+            t.service -= c.len;
+            t.t_cpu += c.len;
+            if (t.burst)
+                t.burst_left -= c.len;
+            policy.charge(tasks, c.idx, c.len);
+
+            if (t.service == 0) {
+                t.t_unused += c.quantum - c.len;
+                m.add(t.kind, (now - t.t_arrival) / 1e3,
+                      (t.t_firstrun - t.t_arrival) / 1e3,
+                      t.t_waiting / 1e3, t.t_cpu / 1e3, t.t_unused / 1e3);
+                policy.leave(tasks, c.idx, true);
+                freelist.push_back(c.idx);
+                finished++;
+                t_end = now;
+            } else if (t.burst && t.burst_left == 0) {
+                t.t_unused += c.quantum - c.len;
+                t.burst_left = t.burst;
+                policy.leave(tasks, c.idx, false);
+                post(now + t.io, ev_type::IO_DONE, c.idx);
+            } else {
+                t.t_laststop = now;
+                policy.preempted(tasks, c.idx, c.len);
+            }
+            if (!dispatch(e.arg))
+                idle.push_back(e.arg);
+            break;
+        }
+        case ev_type::IO_DONE:
+            tasks[e.arg].t_laststop = now;
+            policy.enqueue(tasks, e.arg);
+            kick();
+            break;
+        case ev_type::BOOST:
+            policy.boost(tasks);
+            if (finished < ntasks)
+                post(now + policy.boost_period(), ev_type::BOOST, 0);
+            break;
+        }
+    }
+    double t_elapsed = duration_cast<milliseconds>(
+        steady_clock::now() - t_wall
+    ).count() / 1e3;
+
+    std::cout << "Simulated " << finished << " tasks on " << ncpus
+              << " virtual cpus (" << P::name << ") in " << t_elapsed
+              << "s\n";
+    std::cout << "\nSimulation exited. Obtaining scheduling metrics...\n";
+    m.finalize(t_end / 1e3, ncpus);
+    std::cout << m;
+    policy.report();
+    std::cout << '\n';
+}
+
+template void run<rr_policy>(u64 ntasks, u32 ncpus) noexcept;
+template void run<mlfq_policy>(u64 ntasks, u32 ncpus) noexcept;
+template void run<mlfq64_policy>(u64 ntasks, u32 ncpus) noexcept;
+template void run<mlfq140_policy>(u64 ntasks, u32 ncpus) noexcept;
+template void run<stride_policy>(u64 ntasks, u32 ncpus) noexcept;
+template void run<lottery_policy>(u64 ntasks, u32 ncpus) noexcept;
+template void run<srtf_policy>(u64 ntasks, u32 ncpus) noexcept;
+} // namespace des
@@ -0,0 +1,272 @@
+/* edf.cpp Earliest Deadline First Scheduler */
+#include <iostream>
+#include <algorithm>
+#include <queue>
+#include <vector>
+#include <thread>
+#include <pthread.h>
+#include <semaphore.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <signal.h>
+#include <time.h>
+#include <err.h>
+#include "../include/types.hpp"
+#include "../include/task.hpp"
+#include "../include/aggregator.hpp"
+#include "../include/logger.hpp"
+#include "../include/overhead.hpp"
+#include "../include/histogram.hpp"
+#include "../include/timer.hpp"
+#include "../include/edf.hpp"
+
+namespace scheduler {
+histogram edf::lateness;
+std::atomic<u64> edf::nr_jobs(0);
+std::atomic<u64> edf::nr_misses(0);
+
+u64
+edf::now_us() noexcept
+{
+    return duration_cast<microseconds>(
+        steady_clock::now().time_since_epoch()
+    ).count();
+}
+
+/* cpu time in us the task has received, as of its last stop */
+u64
+edf::cpu_us(const task *t) noexcept
+{
+    return duration_cast<microseconds>(t->get_t_cpu()).count();
+}
+
+/* share of a cpu the task may demand, in EDF_UNIT */
+u64
+edf::density(const rt_entity &rt) noexcept
+{
+    u64 window = rt.period ? std::min(rt.period, rt.rel_deadline)
+                           : rt.rel_deadline;
+    return rt.budget * EDF_UNIT / window;
+}
+
+/* heap order: the earliest deadline is on top, FIFO among equals */
+bool
+edf::later_deadline(task *a, task *b) noexcept
+{
+    const rt_entity *x = a->get_rt(), *y = b->get_rt();
+    return x->deadline != y->deadline ? x->deadline > y->deadline
+                                      : x->seq > y->seq;
+}
+
+bool
+edf::later_release(task *a, task *b) noexcept
+{
+    return a->get_rt()->release > b->get_rt()->release;
+}
+
+/* admit t with parameters p and release its first job */
+bool
+edf::admit(task *t, const rt_params &p) noexcept
+{
+    rt_entity &rt = *t->get_rt();
+    rt.rel_deadline = p.deadline;
+    rt.period = p.period;
+    rt.budget = p.budget;
+    if (!rt.rel_deadline || !rt.budget)
+        errx(EXIT_FAILURE, "edf: deadline and budget must be non-zero");
+
+    u64 d = density(rt);
+    OVERHEAD_LOCK(&mtx);
+    if (util + d > capacity) {
+        nr_rejected++;
+        pthread_mutex_unlock(&mtx);
+        return false;
+    }
+    util += d;
+    nr_admitted++;
+    rt.release = now_us();
+    rt.deadline = rt.release + rt.rel_deadline;
+    rt.t_cpu = 0;
+    pthread_mutex_unlock(&mtx);
+    push(t);
+    return true;
+}
+
+void
+edf::push(task *t) noexcept
+{
+    OVERHEAD_LOCK(&mtx);
+    t->get_rt()->seq = seq++;
+    ready.push(t);
+    pthread_mutex_unlock(&mtx);
+    sem_post(&sem);
+}
+
+/*
+ *  Caller holds mtx. Move throttled tasks whose next job is due to the
+ *  ready queue, then take the earliest deadline. With nothing ready,
+ *  wait_us is how long until the next release
+ */
+task *
+edf::pick(u64 now, u64 *wait_us) noexcept
+{
+    while (!throttled.empty() && throttled.top()->get_rt()->release <= now) {
+        task *t = throttled.top();
+        throttled.pop();
+        t->get_rt()->seq = seq++;
+        ready.push(t);
+    }
+    if (!ready.empty()) {
+        task *t = ready.top();
+        ready.pop();
+        return t;
+    }
+    *wait_us = EDF_IDLE_WAIT_US;
+    if (!throttled.empty())
+        *wait_us = std::min(*wait_us,
+                            throttled.top()->get_rt()->release - now);
+    return nullptr;
+}
+
+/* the current job of t completed at now */
+void
+edf::complete(task *t, u64 now) noexcept
+{
+    const rt_entity &rt = *t->get_rt();
+    nr_jobs.fetch_add(1);
+    if (now > rt.deadline) {
+        nr_misses.fetch_add(1);
+        lateness.record((now - rt.deadline) * 1000);
+    }
+}
+
+void
+edf::schedule(task *t) noexcept
+{
+    rt_entity &rt = *t->get_rt();
+    struct rusage cur;
+
+    OVERHEAD_START(t_dequeue);
+    switch (t->get_state()) {
+    case task_state::RUNNABLE:
+        t->set_t_firstrun(high_resolution_clock::now());
+        t->run();
+        LOG(INFO, STARTED, t, 0);
+        break;
+    case task_state::STOPPED:
+        t->increment_t_waiting(high_resolution_clock::now());
+        kill(t->get_pid(), SIGCONT);
+        break;
+    default:
+        err(EXIT_FAILURE, "unexpected task state");
+    }
+    t->set_state(task_state::RUNNING);
+    OVERHEAD_SINCE(DISPATCH, t_dequeue);
+
+    u64 slice = EDF_QUANTUM_US;
+    if (rt.period) {
+        u64 used = cpu_us(t) - rt.t_cpu;
+        u64 left = rt.budget > used ? rt.budget - used : 0;
+        slice = std::clamp(left, (u64)EDF_MIN_SLICE_US, slice);
+    }
+    slice_timer st(slice);
+    st.wait(t);
+    int wstat = st.stop(t, &cur);
+    t->set_rusage(&cur);
+    u64 now = now_us();
+
+    if (WIFEXITED(wstat)) {
+        t->set_state(task_state::FINISHED);
+        t->set_t_completion(high_resolution_clock::now());
+        complete(t, now);
+        OVERHEAD_LOCK(&mtx);
+        util -= density(rt);
+        pthread_mutex_unlock(&mtx);
+
+        LOG(INFO, EXITED, t, 0);
+        aggregator::retire(t);
+    } else if (WIFSTOPPED(wstat) && WSTOPSIG(wstat) == SIGSTOP) {
+        t->set_state(task_state::STOPPED);
+        t->set_t_laststop(high_resolution_clock::now());
+        if (!rt.period || cpu_us(t) - rt.t_cpu < rt.budget) {
+            push(t);
+            return;
+        }
+        /* budget spent: next job releases a period after this one */
+        complete(t, now);
+        rt.release += rt.period;
+        rt.deadline = rt.release + rt.rel_deadline;
+        rt.t_cpu = cpu_us(t);
+        if (rt.release <= now) {
+            push(t);
+            return;
+        }
+        OVERHEAD_LOCK(&mtx);
+        throttled.push(t);
+        nr_throttled++;
+        pthread_mutex_unlock(&mtx);
+    }
+}
+
+void
+edf::work() noexcept
+{
+    struct timespec ts;
+    u64 wait_us;
+    while (true) {
+        OVERHEAD_LOCK(&mtx);
+        task *t = pick(now_us(), &wait_us);
+        bool done = !t && throttled.empty() && EDF_STOP(flag.load());
+        pthread_mutex_unlock(&mtx);
+        if (t) {
+            schedule(t);
+            continue;
+        }
+        if (done)
+            return;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        ts.tv_nsec += wait_us * 1000;
+        ts.tv_sec += ts.tv_nsec / 1000000000;
+        ts.tv_nsec %= 1000000000;
+        OVERHEAD_START(t_idle);
+        sem_clockwait(&sem, CLOCK_MONOTONIC, &ts);
+        OVERHEAD_SINCE(SEM_WAIT, t_idle);
+    }
+}
+
+edf::edf(u32 ncpus) noexcept
+    : ready(later_deadline),
+      throttled(later_release),
+      util(0),
+      capacity((u64)ncpus * EDF_UNIT),
+      seq(0),
+      nr_admitted(0),
+      nr_rejected(0),
+      nr_throttled(0),
+      flag(0)
+{
+    pthread_mutex_init(&mtx, nullptr);
+    sem_init(&sem, 0, 0);
+    threads.reserve(ncpus);
+    for (u32 cpuid = 0; cpuid < ncpus; ++cpuid)
+        threads.emplace_back([this]{ work(); });
+}
+
+edf::~edf() noexcept
+{
+    flag.fetch_or(EDF_STOP_FLAG);
+    for (size_t i = 0; i < threads.size(); ++i)
+        sem_post(&sem);
+    for (std::thread &th : threads)
+        th.join();
+
+    std::cout << "\nAdmission Control:\n"
+              << "\tAdmitted Tasks:\t\t" << nr_admitted << '\n'
+              << "\tRejected Tasks:\t\t" << nr_rejected << '\n'
+              << "\tBudget Throttles:\t" << nr_throttled << '\n';
+
+    sem_destroy(&sem);
+    pthread_mutex_destroy(&mtx);
+}
+} // namespace scheduler
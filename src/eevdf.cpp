@@ -0,0 +1,376 @@
+/* eevdf.cpp Earliest Eligible Virtual Deadline First Scheduler */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <cassert>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <sys/sysinfo.h>
+#include <sys/types.h>
+#include <signal.h>
+#include <err.h>
+#include "../include/types.hpp"
+#include "../include/task.hpp"
+#include "../include/aggregator.hpp"
+#include "../include/logger.hpp"
+#include "../include/overhead.hpp"
+#include "../include/rbtree.hpp"
+#include "../include/timer.hpp"
+#include "../include/eevdf.hpp"
+
+namespace scheduler {
+static sched_entity *
+se_of(const rb_node *n) noexcept
+{
+    return rb_entry(n, sched_entity, run_node);
+}
+
+static bool
+vruntime_less(const rb_node *a, const rb_node *b) noexcept
+{
+    return se_of(a)->vruntime < se_of(b)->vruntime;
+}
+
+/* augment callback: earliest deadline of the subtree rooted at n */
+static void
+min_deadline_update(rb_node *n) noexcept
+{
+    sched_entity *se = se_of(n);
+    se->min_deadline = se->deadline;
+    if (n->left)
+        se->min_deadline = std::min(se->min_deadline,
+                                    se_of(n->left)->min_deadline);
+    if (n->right)
+        se->min_deadline = std::min(se->min_deadline,
+                                    se_of(n->right)->min_deadline);
+}
+
+/*
+ *  Request size in ns: EEVDF_BASE_SLICE_NS at latency nice 0, scaled
+ *  linearly down to 1/21 of it at NICE_MIN and up to ~2x at NICE_MAX
+ */
+static u64
+request_slice(const sched_entity *se) noexcept
+{
+    u64 slice = (u64)EEVDF_BASE_SLICE_NS * (se->latency_nice - NICE_MIN + 1) /
+                (1 - NICE_MIN);
+    return std::max<u64>(slice, EEVDF_MIN_SLICE_NS);
+}
+
+/* convert ns of cpu time into vruntime for se's weight */
+static u64
+calc_delta(u64 delta, const sched_entity *se) noexcept
+{
+    return delta * NICE_0_WEIGHT / se->weight;
+}
+
+static i64
+entity_key(u64 min_vruntime, const sched_entity *se) noexcept
+{
+    return (i64)(se->vruntime - min_vruntime);
+}
+
+/* V: load weighted average vruntime of the timeline, caller holds rq.mtx */
+u64
+eevdf::avg_vruntime(const runqueue &rq) const noexcept
+{
+    if (rq.avg_load == 0)
+        return rq.min_vruntime;
+    i64 avg = rq.avg_vruntime;
+    if (avg < 0)
+        avg -= rq.avg_load - 1;     // round towards -inf
+    return rq.min_vruntime + avg / (i64)rq.avg_load;
+}
+
+/* vruntime <= V, without the rounding of the division in avg_vruntime */
+bool
+eevdf::eligible(const runqueue &rq, const sched_entity *se) const noexcept
+{
+    return rq.avg_vruntime >=
+           entity_key(rq.min_vruntime, se) * (i64)rq.avg_load;
+}
+
+/*
+ *  Advance min_vruntime to the leftmost task; the keys of avg_vruntime are
+ *  relative to it, so shift the sum along
+ */
+void
+eevdf::update_min_vruntime(runqueue &rq) noexcept
+{
+    rb_node *n = rq.timeline.first();
+    if (!n || se_of(n)->vruntime <= rq.min_vruntime)
+        return;
+    u64 delta = se_of(n)->vruntime - rq.min_vruntime;
+    rq.avg_vruntime -= (i64)(rq.avg_load * delta);
+    rq.min_vruntime = se_of(n)->vruntime;
+}
+
+/* caller holds rq.mtx */
+void
+eevdf::insert(runqueue &rq, sched_entity *se) noexcept
+{
+    rq.avg_vruntime += entity_key(rq.min_vruntime, se) * (i64)se->weight;
+    rq.avg_load += se->weight;
+    rq.timeline.insert(&se->run_node, vruntime_less);
+    rq.nr_peak = std::max(rq.nr_peak, rq.timeline.size());
+    rq.nr_queued++;
+    update_min_vruntime(rq);
+}
+
+/* caller holds rq.mtx */
+void
+eevdf::remove(runqueue &rq, sched_entity *se) noexcept
+{
+    rq.timeline.erase(&se->run_node);
+    rq.avg_vruntime -= entity_key(rq.min_vruntime, se) * (i64)se->weight;
+    rq.avg_load -= se->weight;
+    rq.nr_queued--;
+    update_min_vruntime(rq);
+}
+
+/*
+ *  Position a task joining rq so it keeps its lag. Adding the task moves
+ *  V towards it, so the lag is inflated by (load + w) / load beforehand to
+ *  end up with the intended lag afterwards. Caller holds rq.mtx
+ */
+void
+eevdf::place_entity(runqueue &rq, sched_entity *se) noexcept
+{
+    u64 V = avg_vruntime(rq);
+    i64 lag = se->vlag;
+    if (rq.avg_load)
+        lag = lag * (i64)(rq.avg_load + se->weight) / (i64)rq.avg_load;
+    se->vruntime = (lag > 0 && (u64)lag > V) ? 0 : V - lag;
+    se->deadline = se->vruntime + calc_delta(request_slice(se), se);
+    se->vlag = 0;
+}
+
+/*
+ *  Find the eligible task with the earliest deadline. Eligible tasks form
+ *  a prefix of the timeline: when a node is eligible, so is its whole left
+ *  subtree, whose earliest deadline is known from the augmented value.
+ *  Walk down once to find the best node or subtree, then descend into
+ *  that subtree along min_deadline. Caller holds rq.mtx
+ */
+sched_entity *
+eevdf::pick_eevdf(runqueue &rq) noexcept
+{
+    sched_entity *best = nullptr;
+    rb_node *best_sub = nullptr;
+    u64 best_deadline = std::numeric_limits<u64>::max();
+
+    for (rb_node *n = rq.timeline.top(); n; ) {
+        sched_entity *se = se_of(n);
+        if (!eligible(rq, se)) {
+            n = n->left;
+            continue;
+        }
+        if (n->left && se_of(n->left)->min_deadline < best_deadline) {
+            best_deadline = se_of(n->left)->min_deadline;
+            best_sub = n->left;
+            best = nullptr;
+        }
+        if (se->deadline < best_deadline) {
+            best_deadline = se->deadline;
+            best_sub = nullptr;
+            best = se;
+        }
+        n = n->right;
+    }
+
+    for (rb_node *n = best_sub; n; ) {
+        if (n->left && se_of(n->left)->min_deadline == best_deadline)
+            n = n->left;
+        else if (se_of(n)->deadline == best_deadline)
+            return se_of(n);
+        else
+            n = n->right;
+    }
+    /* the leftmost task is always eligible, so best is only a safeguard */
+    return best ? best : se_of(rq.timeline.first());
+}
+
+sched_entity *
+eevdf::pick(runqueue &rq) noexcept
+{
+    lock(rq, &rq.t_lockwait);
+    if (rq.timeline.empty()) {
+        pthread_mutex_unlock(&rq.mtx);
+        return nullptr;
+    }
+    sched_entity *se = pick_eevdf(rq);
+    if (&se->run_node != rq.timeline.first())
+        rq.nr_early++;
+    remove(rq, se);
+    pthread_mutex_unlock(&rq.mtx);
+    return se;
+}
+
+/*
+ *  Move the leftmost task of the cpu with the most queued tasks onto our
+ *  own timeline. Its lag is bounded by two requests' worth of service
+ */
+bool
+eevdf::pull(runqueue &self) noexcept
+{
+    runqueue *busiest = nullptr;
+    u32 nr_max = 0;
+    for (u32 i = 1; i < ncpus; ++i) {
+        runqueue &rq = rqs[(self.cpu + i) % ncpus];
+        u32 nr = rq.nr_queued.load();
+        if (nr > nr_max) {
+            nr_max = nr;
+            busiest = &rq;
+        }
+    }
+    if (!busiest)
+        return false;
+
+    lock(*busiest, &self.t_lockwait);
+    rb_node *n = busiest->timeline.first();
+    if (!n) {
+        pthread_mutex_unlock(&busiest->mtx);
+        return false;
+    }
+    sched_entity *se = se_of(n);
+    i64 limit = calc_delta(2 * request_slice(se), se);
+    se->vlag = std::clamp((i64)(avg_vruntime(*busiest) - se->vruntime),
+                          -limit, limit);
+    remove(*busiest, se);
+    pthread_mutex_unlock(&busiest->mtx);
+
+    lock(self, &self.t_lockwait);
+    place_entity(self, se);
+    insert(self, se);
+    pthread_mutex_unlock(&self.mtx);
+    self.nr_pulls++;
+    return true;
+}
+
+/* queue t on rq, placing it first if it is joining rather than requeued */
+void
+eevdf::push(runqueue &rq, task *t, bool join, u64 *t_wait) noexcept
+{
+    sched_entity *se = t->get_se();
+    lock(rq, t_wait);
+    if (join)
+        place_entity(rq, se);
+    insert(rq, se);
+    pthread_mutex_unlock(&rq.mtx);
+    wake(rq);
+}
+
+void
+eevdf::schedule(runqueue &self, task *t) noexcept
+{
+    sched_entity *se = t->get_se();
+    struct rusage cur;
+
+    OVERHEAD_START(t_dequeue);
+    switch (t->get_state()) {
+    case task_state::RUNNABLE:
+        t->set_t_firstrun(high_resolution_clock::now());
+        t->run();
+        LOG(INFO, STARTED, t, 0);
+        break;
+    case task_state::STOPPED:
+        t->increment_t_waiting(high_resolution_clock::now());
+        kill(t->get_pid(), SIGCONT);
+        break;
+    default:
+        err(EXIT_FAILURE, "unexpected task state");
+    }
+    t->set_state(task_state::RUNNING);
+    OVERHEAD_SINCE(DISPATCH, t_dequeue);
+
+    /*
+     *  let task run for its request, or until it exits, and charge the
+     *  cpu time it actually used rather than the wall clock of the slice
+     */
+    nanoseconds c0 = t->get_t_cpu();
+    slice_timer st(request_slice(se) / 1000);
+    st.wait(t);
+    int wstat = st.stop(t, &cur);
+    u64 delta = (t->get_t_cpu() - c0).count();
+    se->vruntime += calc_delta(delta, se);
+    t->set_rusage(&cur);
+
+    if (WIFEXITED(wstat)) {
+        assert(WEXITSTATUS(wstat) == 0);
+        t->set_state(task_state::FINISHED);
+        t->set_t_completion(high_resolution_clock::now());
+
+        LOG(INFO, EXITED, t, 0);
+        aggregator::retire(t);
+    } else if (WIFSTOPPED(wstat) && WSTOPSIG(wstat) == SIGSTOP) {
+        /* request served: issue the next one */
+        if (se->vruntime >= se->deadline)
+            se->deadline = se->vruntime + calc_delta(request_slice(se), se);
+        t->set_state(task_state::STOPPED);
+        t->set_t_laststop(high_resolution_clock::now());
+        push(self, t, false, &self.t_lockwait);
+        kick(self);
+    }
+}
+
+/* run the task picked from self, or pull one from the busiest cpu */
+bool
+eevdf::dispatch(runqueue &self) noexcept
+{
+    if (sched_entity *se = pick(self)) {
+        self.nr_dispatch++;
+        schedule(self, se->owner);
+        return true;
+    }
+    return pull(self);
+}
+
+eevdf::eevdf(u32 ncpus, i32 mem_latency_nice) noexcept
+    : percpu(ncpus, EEVDF_IDLE_WAIT_US),
+      mem_latency_nice(mem_latency_nice)
+{
+    for (u32 i = 0; i < ncpus; ++i) {
+        rqs[i].timeline = rb_tree(min_deadline_update);
+        rqs[i].min_vruntime = 0;
+        rqs[i].avg_vruntime = 0;
+        rqs[i].avg_load = 0;
+        rqs[i].nr_early = 0;
+        rqs[i].nr_pulls = 0;
+        rqs[i].nr_peak = 0;
+    }
+    start();
+}
+
+/* join all threads and report per-cpu statistics */
+eevdf::~eevdf() noexcept
+{
+    stop();
+
+    u64 nr_dispatch = 0, nr_early = 0, nr_pulls = 0;
+    report("EEVDF", [&](const runqueue &rq) {
+        std::cout << rq.nr_early << " deadline picks, "
+                  << rq.nr_pulls << " pulls, "
+                  << rq.nr_peak << " peak queued, ";
+        nr_dispatch += rq.nr_dispatch;
+        nr_early += rq.nr_early;
+        nr_pulls += rq.nr_pulls;
+    }, [&] {
+        std::cout << "Deadline Picks (not leftmost):\t\t" << nr_early << '/'
+                  << nr_dispatch << '\n'
+                  << "Total Pulls:\t\t\t\t" << nr_pulls << '\n';
+    });
+}
+
+void
+eevdf::enqueue(task *t) noexcept
+{
+    push(place(true), t, true, nullptr);
+}
+} // namespace scheduler
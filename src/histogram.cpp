@@ -0,0 +1,109 @@
+#include <array>
+#include <atomic>
+#include <algorithm>
+#include "../include/types.hpp"
+#include "../include/histogram.hpp"
+
+u32
+histogram::bucket(u64 v) noexcept
+{
+    if (v < HIST_SUB)
+        return v;
+    u32 msb = 63 - __builtin_clzll(v);
+    u32 shift = msb - HIST_SUB_BITS;
+    return (shift + 1) * HIST_SUB + ((v >> shift) - HIST_SUB);
+}
+
+/* smallest value that maps to bucket idx */
+u64
+histogram::lowest(u32 idx) noexcept
+{
+    u32 group = idx / HIST_SUB, sub = idx % HIST_SUB;
+    if (group == 0)
+        return sub;
+    return (u64)(HIST_SUB + sub) << (group - 1);
+}
+
+histogram::histogram() noexcept
+{
+    reset();
+}
+
+void
+histogram::record(u64 v) noexcept
+{
+    counts[bucket(v)].fetch_add(1, std::memory_order_relaxed);
+    total.fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(v, std::memory_order_relaxed);
+    u64 cur = vmax.load(std::memory_order_relaxed);
+    while (v > cur &&
+           !vmax.compare_exchange_weak(cur, v, std::memory_order_relaxed))
+        ;
+}
+
+void
+histogram::merge(const histogram &h) noexcept
+{
+    for (u32 i = 0; i < HIST_BUCKETS; ++i) {
+        u64 n = h.counts[i].load(std::memory_order_relaxed);
+        if (n)
+            counts[i].fetch_add(n, std::memory_order_relaxed);
+    }
+    total.fetch_add(h.count(), std::memory_order_relaxed);
+    sum.fetch_add(h.sum.load(std::memory_order_relaxed),
+                  std::memory_order_relaxed);
+    u64 v = h.max(), cur = vmax.load(std::memory_order_relaxed);
+    while (v > cur &&
+           !vmax.compare_exchange_weak(cur, v, std::memory_order_relaxed))
+        ;
+}
+
+void
+histogram::reset() noexcept
+{
+    for (std::atomic<u64> &c : counts)
+        c.store(0, std::memory_order_relaxed);
+    total.store(0, std::memory_order_relaxed);
+    sum.store(0, std::memory_order_relaxed);
+    vmax.store(0, std::memory_order_relaxed);
+}
+
+u64
+histogram::count() const noexcept
+{
+    return total.load(std::memory_order_relaxed);
+}
+
+u64
+histogram::max() const noexcept
+{
+    return vmax.load(std::memory_order_relaxed);
+}
+
+double
+histogram::mean() const noexcept
+{
+    u64 n = count();
+    return n ? (double)sum.load(std::memory_order_relaxed) / n : 0.0;
+}
+
+/* value at percentile p (0-100), reported as the midpoint of its bucket */
+u64
+histogram::percentile(double p) const noexcept
+{
+    u64 n = count();
+    if (n == 0)
+        return 0;
+    u64 rank = std::max<u64>(1, (u64)(p / 100.0 * n + 0.5));
+    u64 seen = 0;
+    for (u32 i = 0; i < HIST_BUCKETS; ++i) {
+        seen += counts[i].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            if (i + 1 == HIST_BUCKETS)
+                return max();
+            u64 lo = lowest(i), hi = lowest(i + 1);
+            return std::min(lo + (hi - lo) / 2, max());
+        }
+    }
+    return max();
+}
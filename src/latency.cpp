@@ -0,0 +1,51 @@
+/* latency.cpp Per-Thread Latency Histograms */
+#include <atomic>
+#include "../include/types.hpp"
+#include "../include/task.hpp"
+#include "../include/histogram.hpp"
+#include "../include/registry.hpp"
+#include "../include/latency.hpp"
+
+thread_registry<latency::shard> latency::shards;
+
+void
+latency::record(lat_metric m, task_kind k, u64 ns) noexcept
+{
+    shards.local().by_kind[(u32)m][(u32)k].record(ns);
+}
+
+void
+latency::record_level(u32 lvl, u64 ns) noexcept
+{
+    if (lvl >= LAT_LEVELS)
+        return;
+    shard &s = shards.local();
+    histogram *h = s.by_level[lvl].load(std::memory_order_relaxed);
+    if (!h) {
+        h = new histogram();
+        s.by_level[lvl].store(h, std::memory_order_release);
+    }
+    h->record(ns);
+}
+
+void
+latency::merge(lat_metric m, task_kind k, histogram *out) noexcept
+{
+    shards.for_each([&](const shard &s) {
+        out->merge(s.by_kind[(u32)m][(u32)k]);
+    });
+}
+
+bool
+latency::merge_level(u32 lvl, histogram *out) noexcept
+{
+    bool any = false;
+    shards.for_each([&](const shard &s) {
+        histogram *h = s.by_level[lvl].load(std::memory_order_acquire);
+        if (h && h->count()) {
+            out->merge(*h);
+            any = true;
+        }
+    });
+    return any;
+}
@@ -0,0 +1,209 @@
+#include <mutex>
+#include <vector>
+#include <cstring>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <sys/prctl.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <err.h>
+#include <cerrno>
+#include "../include/types.hpp"
+#include "../include/overhead.hpp"
+#include "../include/launcher.hpp"
+
+#define ZYGOTE_MSG_SIZE 1024
+
+extern char **environ;
+
+launch_method       launcher::method = launch_method::FORK;
+int                 launcher::sock = -1;
+pid_t               launcher::zygote = -1;
+std::mutex          launcher::mtx;
+std::vector<char *> launcher::envp_run;
+std::vector<char *> launcher::envp_stop;
+
+/*
+ *  Fork server loop. A request is one datagram holding the stop flag
+ *  followed by the NUL separated path and argument vector. Each child is
+ *  double forked: the intermediate process reports the grandchild pid
+ *  through a pipe and exits, and the reply is only sent once the
+ *  intermediate has been reaped, i.e. once the grandchild has been
+ *  reparented to schedsim
+ */
+void
+launcher::zygote_main(int fd) noexcept
+{
+    char msg[ZYGOTE_MSG_SIZE];
+    char *argv[64];
+    while (true) {
+        ssize_t n = recv(fd, msg, sizeof(msg) - 1, 0);
+        if (n <= 0)
+            _exit(0);
+        msg[n] = '\0';
+
+        bool stopped = msg[0];
+        char *path = msg + 1;
+        u32 argc = 0;
+        for (char *p = path + strlen(path) + 1;
+             p < msg + n && *p && argc < 63; p += strlen(p) + 1)
+            argv[argc++] = p;
+        argv[argc] = nullptr;
+
+        pid_t gpid = -1;
+        int p[2];
+        if (pipe(p) < 0)
+            _exit(EXIT_FAILURE);
+        pid_t mid = fork();
+        if (mid == 0) {
+            close(p[0]);
+            if ((gpid = fork()) == 0) {
+                execve(path, argv, stopped ? envp_stop.data()
+                                           : envp_run.data());
+                _exit(127);
+            }
+            write(p[1], &gpid, sizeof(gpid));
+            _exit(0);
+        }
+        close(p[1]);
+        if (mid < 0 || read(p[0], &gpid, sizeof(gpid)) != sizeof(gpid))
+            gpid = -1;
+        close(p[0]);
+        if (mid > 0)
+            waitpid(mid, nullptr, 0);
+        send(fd, &gpid, sizeof(gpid), 0);
+    }
+}
+
+pid_t
+launcher::zygote_spawn(const char *path, char *const argv[], bool stopped)
+noexcept
+{
+    char msg[ZYGOTE_MSG_SIZE];
+    size_t n = 0, len;
+    msg[n++] = stopped;
+    len = strlen(path) + 1;
+    memcpy(msg + n, path, len);
+    n += len;
+    for (u32 i = 0; argv[i]; ++i) {
+        len = strlen(argv[i]) + 1;
+        if (n + len >= sizeof(msg))
+            errx(EXIT_FAILURE, "zygote request too long");
+        memcpy(msg + n, argv[i], len);
+        n += len;
+    }
+    msg[n++] = '\0';
+
+    pid_t pid;
+    std::lock_guard<std::mutex> lk(mtx);
+    if (send(sock, msg, n, 0) < 0)
+        err(EXIT_FAILURE, "send");
+    if (recv(sock, &pid, sizeof(pid), 0) != sizeof(pid) || pid < 0)
+        errx(EXIT_FAILURE, "zygote failed to spawn %s", path);
+    return pid;
+}
+
+/*
+ *  Select the launch method. Must be called before any scheduler thread
+ *  is created, since the zygote is forked from the calling process
+ */
+void
+launcher::init(launch_method m) noexcept
+{
+    method = m;
+    if (envp_run.empty()) {
+        static char stop_env[] = LAUNCH_STOPPED_ENV "=1";
+        for (char **e = environ; *e; ++e) {
+            envp_run.push_back(*e);
+            envp_stop.push_back(*e);
+        }
+        envp_run.push_back(nullptr);
+        envp_stop.push_back(stop_env);
+        envp_stop.push_back(nullptr);
+    }
+    if (m != launch_method::ZYGOTE || zygote > 0)
+        return;
+
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds) < 0)
+        err(EXIT_FAILURE, "socketpair");
+    if (prctl(PR_SET_CHILD_SUBREAPER, 1) < 0)
+        err(EXIT_FAILURE, "prctl");
+    if ((zygote = fork()) < 0)
+        err(EXIT_FAILURE, "fork");
+    if (zygote == 0) {
+        close(fds[0]);
+        zygote_main(fds[1]);
+    }
+    close(fds[1]);
+    sock = fds[0];
+}
+
+launch_method
+launcher::get_method() noexcept
+{
+    return method;
+}
+
+const char *
+launcher::name(launch_method m) noexcept
+{
+    switch (m) {
+    case launch_method::FORK:   return "fork";
+    case launch_method::SPAWN:  return "posix_spawn";
+    case launch_method::VFORK:  return "vfork";
+    case launch_method::ZYGOTE: return "zygote";
+    }
+    return "unknown";
+}
+
+/*
+ *  Launch path with argv using the selected method. If stopped is set, the
+ *  child is exec'd, parks itself and is only returned once it is stopped
+ */
+pid_t
+launcher::spawn(const char *path, char *const argv[], bool stopped) noexcept
+{
+    char **envp = stopped ? envp_stop.data() : envp_run.data();
+    OVERHEAD_START(t0);
+    pid_t pid = -1;
+    int rc;
+    switch (method) {
+    case launch_method::FORK:
+        if ((pid = fork()) < 0)
+            err(EXIT_FAILURE, "fork");
+        if (pid == 0) {
+            execve(path, argv, envp);
+            err(EXIT_FAILURE, "execve");
+        }
+        break;
+    case launch_method::SPAWN:
+        if ((rc = posix_spawn(&pid, path, nullptr, nullptr, argv, envp))) {
+            errno = rc;
+            err(EXIT_FAILURE, "posix_spawn");
+        }
+        break;
+    case launch_method::VFORK:
+        if ((pid = vfork()) < 0)
+            err(EXIT_FAILURE, "vfork");
+        if (pid == 0) {
+            execve(path, argv, envp);
+            _exit(127);
+        }
+        break;
+    case launch_method::ZYGOTE:
+        pid = zygote_spawn(path, argv, stopped);
+        break;
+    }
+
+    if (stopped) {
+        int wstat;
+        if (waitpid(pid, &wstat, WUNTRACED) < 0)
+            err(EXIT_FAILURE, "waitpid");
+        if (!WIFSTOPPED(wstat))
+            errx(EXIT_FAILURE, "%s did not stop after exec", path);
+    }
+    OVERHEAD_SINCE(LAUNCH, t0);
+    return pid;
+}
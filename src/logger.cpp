@@ -0,0 +1,131 @@
+/* logger.cpp Asynchronous Logger */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../include/types.hpp"
+#include "../include/registry.hpp"
+#include "../include/logger.hpp"
+
+thread_registry<logger::ring>   logger::rings;
+std::mutex                      logger::mtx;
+std::condition_variable         logger::cv;
+std::thread                     logger::writer;
+bool                            logger::stop = false;
+std::atomic<u8>                 logger::level((u8)log_level::INFO);
+std::atomic<u64>                logger::dropped(0);
+
+void
+logger::log(log_event ev, u32 task, pid_t pid, u32 arg) noexcept
+{
+    ring &r = rings.local();
+    u64 h = r.head.load(std::memory_order_relaxed);
+    if (h - r.tail.load(std::memory_order_acquire) == LOG_RING) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    r.buf[h % LOG_RING] = {
+        (u64)duration_cast<nanoseconds>(
+            steady_clock::now().time_since_epoch()
+        ).count(),
+        task, pid, arg, ev
+    };
+    r.head.store(h + 1, std::memory_order_release);
+}
+
+static const char *
+event_name(log_event ev) noexcept
+{
+    switch (ev) {
+    case log_event::STARTED:
+        return "started";
+    case log_event::EXITED:
+        return "exited";
+    case log_event::DEMOTED:
+        return "demoted to level";
+    case log_event::STOLEN:
+        return "stolen by cpu";
+    }
+    return "?";
+}
+
+/* caller holds mtx: take every published record, oldest first, and write */
+void
+logger::drain() noexcept
+{
+    std::vector<log_record> batch;
+    rings.for_each([&](ring &r) {
+        u64 t = r.tail.load(std::memory_order_relaxed);
+        u64 h = r.head.load(std::memory_order_acquire);
+        for (; t < h; ++t)
+            batch.push_back(r.buf[t % LOG_RING]);
+        r.tail.store(t, std::memory_order_release);
+    });
+    if (batch.empty())
+        return;
+    std::stable_sort(batch.begin(), batch.end(),
+                     [](const log_record &a, const log_record &b) {
+                         return a.ts < b.ts;
+                     });
+
+    std::string out;
+    char line[96];
+    for (const log_record &rec : batch) {
+        int n = snprintf(line, sizeof(line), "(Task %u, PID: %d) %s",
+                         rec.task, rec.pid, event_name(rec.ev));
+        out.append(line, n);
+        if (rec.ev == log_event::DEMOTED || rec.ev == log_event::STOLEN)
+            out += ' ' + std::to_string(rec.arg);
+        out += '\n';
+    }
+    std::cout.write(out.data(), out.size());
+    std::cout.flush();
+}
+
+/* writer thread: drain every LOG_FLUSH_MS until shut down */
+void
+logger::run() noexcept
+{
+    std::unique_lock<std::mutex> lk(mtx);
+    while (!stop) {
+        cv.wait_for(lk, milliseconds(LOG_FLUSH_MS), []{ return stop; });
+        drain();
+    }
+}
+
+void
+logger::init(log_level lvl) noexcept
+{
+    level.store((u8)lvl);
+    if (lvl != log_level::OFF)
+        writer = std::thread(run);
+}
+
+void
+logger::flush() noexcept
+{
+    std::lock_guard<std::mutex> lk(mtx);
+    drain();
+}
+
+/* stop the writer after a final drain and report dropped records */
+void
+logger::shutdown() noexcept
+{
+    {
+        std::lock_guard<std::mutex> lk(mtx);
+        stop = true;
+    }
+    cv.notify_all();
+    if (writer.joinable())
+        writer.join();
+    flush();
+    if (u64 n = dropped.load())
+        fprintf(stderr, "log: %lu records dropped (ring full)\n", n);
+}
@@ -2,10 +2,16 @@
 #include <vector>
 #include <string>
 #include <cstdlib>
+#include <csignal>
+#include "../include/launcher.hpp"
 
 int
 main(int argc, char *argv[])
 {
+    /* launched as a pre-exec'd child: wait for the scheduler to start us */
+    if (getenv(LAUNCH_STOPPED_ENV))
+        raise(SIGSTOP);
+
     std::random_device rd;
     std::mt19937 gen(rd());
     std::uniform_int_distribution<size_t> dist(0, 4095);
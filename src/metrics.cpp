@@ -1,119 +1,327 @@
 #include <vector>
+#include <algorithm>
 #include <chrono>
 #include <cstdint>
 #include <cassert>
 #include <iostream>
-#include <iomanip>
+#include <string>
 #include <unistd.h>
 #include <sys/sysinfo.h>
 #include <sys/time.h>
 #include "../include/task.hpp"
 #include "../include/types.hpp"
+#include "../include/histogram.hpp"
+#include "../include/latency.hpp"
+#include "../include/overhead.hpp"
+#include "../include/perfctr.hpp"
+#include "../include/timer.hpp"
+#include "../include/procpool.hpp"
+#include "../include/srtf.hpp"
+#include "../include/edf.hpp"
 #include "../include/metrics.hpp"
 
-/*
- *  Dynamic casting a dereferenced base pointer will throw an exception, so
- *  attempting the dynamic cast can confirm the underlying type pointed to
- */
-bool
-metrics::is_cpu_task(task *t) const noexcept
+/* nanosecond task time as fractional milliseconds */
+double
+metrics::ms(nanoseconds t) noexcept
 {
-    try {
-        dynamic_cast<cpu_task &>(*t);
-    } catch (...) {
-        return false;
-    }
-    return true;
+    return duration<double, std::milli>(t).count();
 }
 
-bool
-metrics::is_mem_task(task *t) const noexcept
-{
-    try {
-        dynamic_cast<mem_task &>(*t);
-    } catch (...) {
-        return false;
-    }
-    return true;
-}
-
-/* Get total task CPU Time */
-float
-metrics::get_cpu_time(const struct rusage *ru) const noexcept
-{
-    float cpu_t = static_cast<float>(
-        (ru->ru_utime.tv_sec * 1000) + (ru->ru_utime.tv_usec / 1000) +
-        (ru->ru_stime.tv_sec * 1000) + (ru->ru_stime.tv_usec / 1000)
-    );
-    return cpu_t;
-}
-
-/* get millisecond time difference between two timeval structures */
-float
-metrics::get_time_diff(const struct timeval &l, const struct timeval &r) 
-const noexcept
-{
-    return static_cast<float>(
-        ((r.tv_sec * 1000) + (r.tv_usec / 1000)) - 
-        ((l.tv_sec * 1000) + (l.tv_usec / 1000))
-    );
-}
-
-metrics::metrics(const std::vector<task *> &tasks, 
-                 const struct timeval &t_start) noexcept
+metrics::metrics() noexcept
     : avg_t_turnaround(0.0f), 
       avg_t_response(0.0f), 
       avg_t_waiting(0.0f), 
       avg_t_running(0.0f), 
       cpu_utilization(0.0f), 
       throughput(0.0f),
-      num_tasks(tasks.size()), 
+      fairness(0.0f),
+      sum_share(0.0f),
+      sum_share_sq(0.0f),
+      num_tasks(0), 
       num_cpu_tasks(0), 
       num_mem_tasks(0),
       avg_rt_cpu_tasks(0.0f), 
       avg_rt_mem_tasks(0.0f),
-      t_total(0.0f)
+      t_total(0.0f),
+      t_reclaimed(0.0f),
+      avg_t_rqdelay(0.0f),
+      min_slowdown{ 0.0f, 0.0f },
+      max_slowdown{ 0.0f, 0.0f },
+      perf{},
+      num_perf{ 0, 0 }
+{}
+
+/*
+ *  (sum x)^2 / (n * sum x^2): 1 when every x is equal, 1 / n when one
+ *  sample holds everything
+ */
+double
+metrics::jain(double sum, double sum_sq, u64 n) noexcept
 {
-    u32 ncpus = get_nprocs();
-    struct timeval t_now;
-    gettimeofday(&t_now, nullptr);
-
-    t_total = get_time_diff(t_start, t_now);
-    
-    throughput = static_cast<float>(num_tasks);
-    for (task *t : tasks) {
-        assert(t->get_state() == task_state::FINISHED);
-        
-        auto t_turnaround   = t->get_t_turnaround().count();
-        auto t_waiting      = t->get_t_waiting().count();
-        auto t_running      = t_turnaround - t_waiting;
-
-        avg_t_turnaround    += t_turnaround;
-        avg_t_response      += t->get_t_response().count();
-        avg_t_waiting       += t_waiting;
-        avg_t_running       += t_running;
-        
-        cpu_utilization     += get_cpu_time(t->get_rusage());
-        
-        if (is_cpu_task(t)) {
-            avg_rt_cpu_tasks += t_running;
-            num_cpu_tasks++;
-        } else if (is_mem_task(t)) {
-            avg_rt_mem_tasks += t_running;
-            num_mem_tasks++;
-        }
+    return (n && sum_sq > 0) ? sum * sum / (n * sum_sq) : 1.0;
+}
+
+/* accumulate one finished task */
+void
+metrics::add(const task *t) noexcept
+{
+    assert(t->get_state() == task_state::FINISHED);
+    add(t->get_kind(),
+        ms(t->get_t_turnaround()),
+        ms(t->get_t_response()),
+        ms(t->get_t_waiting()),
+        ms(t->get_t_cpu()),
+        ms(t->get_t_reclaimed()));
+    avg_t_rqdelay += ms(t->get_t_rqdelay());
+
+    const perf_counters &pc = t->get_perf();
+    if (perfctr::opened(pc, perf_counter::TASK_CLOCK)) {
+        u32 k = (u32)t->get_kind();
+        for (u32 i = 0; i < (u32)perf_counter::NR; ++i)
+            perf[k][i] += pc.val[i];
+        num_perf[k]++;
     }
+}
+
+void
+metrics::add(task_kind kind, double t_turnaround, double t_response,
+             double t_waiting, double t_cpu, double t_unused) noexcept
+{
+    double t_running     = t_turnaround - t_waiting;
+
+    avg_t_turnaround    += t_turnaround;
+    avg_t_response      += t_response;
+    avg_t_waiting       += t_waiting;
+    avg_t_running       += t_running;
+    cpu_utilization     += t_cpu;
+    t_reclaimed         += t_unused;
+    num_tasks++;
+
+    if (t_cpu > 0 && t_turnaround > 0) {
+        double share = t_cpu / t_turnaround, slowdown = 1 / share;
+        u32 k = (u32)kind;
+        sum_share += share;
+        sum_share_sq += share * share;
+        if (min_slowdown[k] == 0 || slowdown < min_slowdown[k])
+            min_slowdown[k] = slowdown;
+        max_slowdown[k] = std::max(max_slowdown[k], slowdown);
+    }
+
+    if (kind == task_kind::CPU) {
+        avg_rt_cpu_tasks += t_running;
+        num_cpu_tasks++;
+    } else {
+        avg_rt_mem_tasks += t_running;
+        num_mem_tasks++;
+    }
+}
+
+void
+metrics::finalize(double t_total_ms, u32 ncpus) noexcept
+{
+    t_total              = t_total_ms;
+    throughput           = static_cast<double>(num_tasks);
     avg_t_turnaround    /= num_tasks;                   // (1)
     avg_t_response      /= num_tasks;                   // (2)
     avg_t_waiting       /= num_tasks;                   // (3)
     avg_t_running       /= num_tasks;                   // (4)
     cpu_utilization     /= ((t_total * ncpus) / 100);   // (5)
     throughput          /= (t_total / 1000);            // (6)
+    fairness             = jain(sum_share, sum_share_sq,
+                                num_tasks);             // (7)
     avg_rt_cpu_tasks    /= num_cpu_tasks;               // (11)
     avg_rt_mem_tasks    /= num_mem_tasks;               // (12)
+    avg_t_rqdelay       /= num_tasks;                   // (22)
     t_total             /= 1000;                        // (13)
 }
 
+/* print p50/p90/p99/max of a nanosecond histogram in microseconds */
+std::ostream &
+metrics::print_percentiles(std::ostream &os, const histogram &h)
+{
+    os << h.percentile(50) / 1e3 << '/' 
+       << h.percentile(90) / 1e3 << '/'
+       << h.percentile(99) / 1e3 << '/'
+       << h.max() / 1e3 << "us";
+    return os;
+}
+
+/*
+ *  Tab and label padded with spaces to the value column. Padding the
+ *  string rather than using std::left/setw leaves the caller's stream
+ *  flags alone
+ */
+static std::ostream &
+print_label(std::ostream &os, const std::string &label)
+{
+    os << '\t' << label;
+    if (label.size() < 36)
+        os << std::string(36 - label.size(), ' ');
+    return os;
+}
+
+/* print p50/p90/p99/p99.9/max of a nanosecond histogram in unit */
+std::ostream &
+metrics::print_tail(std::ostream &os, const histogram &h, double unit_ns,
+                    const char *unit)
+{
+    os << h.percentile(50) / unit_ns << '/'
+       << h.percentile(90) / unit_ns << '/'
+       << h.percentile(99) / unit_ns << '/'
+       << h.percentile(99.9) / unit_ns << '/'
+       << h.max() / unit_ns << unit;
+    return os;
+}
+
+/* the per-thread latency histograms, merged, by class and by mlfq level */
+std::ostream &
+metrics::print_latency(std::ostream &os)
+{
+    static const struct {
+        lat_metric  m;
+        const char  *name;
+        double      unit_ns;
+        const char  *unit;
+    } rows[] = {
+        { lat_metric::TURNAROUND, "Turnaround", 1e6, "ms" },
+        { lat_metric::RESPONSE, "Response", 1e6, "ms" },
+        { lat_metric::WAITING, "Waiting", 1e6, "ms" },
+        { lat_metric::OVERSHOOT, "Slice Overshoot", 1e3, "us" }
+    };
+    static const struct {
+        task_kind   k;
+        const char  *name;
+    } kinds[] = {
+        { task_kind::CPU, "CPU Bound" },
+        { task_kind::MEM, "Memory Bound" }
+    };
+
+    histogram h;
+    bool header = false;
+    for (const auto &r : rows) {
+        for (const auto &k : kinds) {
+            h.reset();
+            latency::merge(r.m, k.k, &h);
+            if (!h.count())
+                continue;
+            if (!header) {
+                os << "Latency (p50/p90/p99/p99.9/max):\n";
+                header = true;
+            }
+            std::string label = std::string(r.name) + " (" + k.name + "):";
+            print_label(os, label);
+            print_tail(os, h, r.unit_ns, r.unit) << '\n';
+        }
+    }
+    for (u32 lvl = 0; lvl < LAT_LEVELS; ++lvl) {
+        h.reset();
+        if (!latency::merge_level(lvl, &h))
+            continue;
+        std::string label = "Slice Overshoot (Level " +
+                            std::to_string(lvl) + "):";
+        print_label(os, label);
+        print_tail(os, h, 1e3, "us") << '\n';
+    }
+    return os;
+}
+
+/*
+ *  The simulator's own cost, merged over all threads, then the busy part
+ *  of it (everything but semaphore waits) spread over the threads
+ */
+std::ostream &
+metrics::print_overhead(std::ostream &os)
+{
+    static const struct {
+        ovh_metric  m;
+        const char  *name;
+    } rows[] = {
+        { ovh_metric::LOCK_WAIT, "Lock Wait:" },
+        { ovh_metric::SEM_WAIT, "Semaphore Wait:" },
+        { ovh_metric::DISPATCH, "Dispatch:" },
+        { ovh_metric::STOP, "SIGSTOP Latency:" },
+        { ovh_metric::LAUNCH, "Launch:" },
+        { ovh_metric::GET_STATE, "get_state /proc Fallback:" }
+    };
+
+    histogram h;
+    bool header = false;
+    for (const auto &r : rows) {
+        h.reset();
+        overhead::merge(r.m, &h);
+        if (!h.count())
+            continue;
+        if (!header) {
+            os << "Scheduler Overhead (p50/p90/p99/p99.9/max, total):\n";
+            header = true;
+        }
+        print_label(os, r.name);
+        print_tail(os, h, 1e3, "us") << ", "
+            << h.mean() * h.count() / 1e6 << "ms\n";
+    }
+
+    std::vector<u64> busy = overhead::per_thread();
+    if (busy.empty())
+        return os;
+    auto [lo, hi] = std::minmax_element(busy.begin(), busy.end());
+    u64 sum = 0;
+    for (u64 ns : busy)
+        sum += ns;
+    std::string label = "Per Thread (min/mean/max of " +
+                        std::to_string(busy.size()) + "):";
+    print_label(os, label)
+       << *lo / 1e6 << '/' << sum / 1e6 / busy.size() << '/'
+       << *hi / 1e6 << "ms\n";
+    return os;
+}
+
+/*
+ *  Counter totals of the finished tasks of each class: IPC and LLC misses
+ *  per 1k instructions when the hardware counters were there, and the
+ *  software events per second the class spent on a cpu
+ */
+std::ostream &
+metrics::print_perf(std::ostream &os) const
+{
+    static const struct {
+        task_kind   k;
+        const char  *name;
+    } kinds[] = {
+        { task_kind::CPU, "CPU Bound" },
+        { task_kind::MEM, "Memory Bound" }
+    };
+    auto row = [&os](const char *name, const char *kind) -> std::ostream & {
+        std::string label = std::string(name) + " (" + kind + "):";
+        return print_label(os, label);
+    };
+
+    if (!num_perf[0] && !num_perf[1])
+        return os;
+    os << "Performance Counters (" << perfctr::name(perfctr::source())
+       << "):\n";
+    for (const auto &k : kinds) {
+        const u64 *c = perf[(u32)k.k];
+        if (!num_perf[(u32)k.k])
+            continue;
+        if (u64 insn = c[(u32)perf_counter::INSTRUCTIONS]) {
+            if (u64 cycles = c[(u32)perf_counter::CYCLES])
+                row("IPC", k.name) << (double)insn / cycles << '\n';
+            row("LLC Misses per 1k Insn", k.name)
+                << c[(u32)perf_counter::LLC_MISSES] * 1e3 / insn << '\n';
+        }
+        double cpu_s = c[(u32)perf_counter::TASK_CLOCK] / 1e9;
+        if (cpu_s <= 0)
+            continue;
+        row("Context Switches", k.name)
+            << c[(u32)perf_counter::CTX_SWITCHES] / cpu_s << "/cpu s\n";
+        row("Migrations", k.name)
+            << c[(u32)perf_counter::MIGRATIONS] / cpu_s << "/cpu s\n";
+        row("Page Faults", k.name)
+            << c[(u32)perf_counter::PAGE_FAULTS] / cpu_s << "/cpu s\n";
+    }
+    return os;
+}
+
 std::ostream &
 operator<<(std::ostream &os, const metrics &m)
 {
@@ -140,6 +348,44 @@ operator<<(std::ostream &os, const metrics &m)
        << "Average Runtime (CPU Bound Tasks):\t" 
        << m.avg_rt_cpu_tasks << "ms\n"
        << "Average Runtime (Memory Bound Tasks):\t" 
-       << m.avg_rt_mem_tasks << "ms\n";
+       << m.avg_rt_mem_tasks << "ms\n"
+       << "Slice Time Reclaimed:\t\t\t"
+       << m.t_reclaimed << "ms\n"
+       << "Fairness (Jain's Index):\t\t"
+       << m.fairness << '\n';
+    if (m.num_cpu_tasks)
+        os << "Slowdown (CPU Bound, min/max):\t\t"
+           << m.min_slowdown[(u32)task_kind::CPU] << '/'
+           << m.max_slowdown[(u32)task_kind::CPU] << '\n';
+    if (m.num_mem_tasks)
+        os << "Slowdown (Memory Bound, min/max):\t"
+           << m.min_slowdown[(u32)task_kind::MEM] << '/'
+           << m.max_slowdown[(u32)task_kind::MEM] << '\n';
+    if (m.avg_t_rqdelay > 0)
+        os << "Average Kernel Run Queue Delay:\t\t"
+           << m.avg_t_rqdelay << "ms\n";
+    if (runtime_predictor::error.count()) {
+        const histogram &e = runtime_predictor::error;
+        os << "Runtime Prediction Error (p50/p90/p99/max):\t"
+           << e.percentile(50) / 10.0 << '/'
+           << e.percentile(90) / 10.0 << '/'
+           << e.percentile(99) / 10.0 << '/'
+           << e.max() / 10.0 << "%\n";
+    }
+    if (u64 jobs = scheduler::edf::nr_jobs.load()) {
+        os << "Deadline Miss Ratio:\t\t\t"
+           << scheduler::edf::nr_misses.load() * 100.0 / jobs << "% of "
+           << jobs << " jobs\n";
+        if (scheduler::edf::lateness.count()) {
+            os << "Lateness of Misses (p50/p90/p99/max):\t";
+            metrics::print_percentiles(os, scheduler::edf::lateness) << '\n';
+        }
+    }
+    metrics::print_latency(os);
+    metrics::print_overhead(os);
+    m.print_perf(os);
+    if (procpool::enabled())
+        os << "Process Pool Hits/Misses:\t\t"
+           << procpool::hits.load() << '/' << procpool::misses.load() << '\n';
     return os;
 }
@@ -2,7 +2,7 @@
 #define _GNU_SOURCE
 #endif
 #include <iostream>
-#include <queue>
+#include <deque>
 #include <array>
 #include <atomic>
 #include <cassert>
@@ -18,28 +18,29 @@
 #include <err.h>
 #include "../include/types.hpp"
 #include "../include/task.hpp"
+#include "../include/aggregator.hpp"
+#include "../include/logger.hpp"
+#include "../include/overhead.hpp"
+#include "../include/timer.hpp"
+#include "../include/trace.hpp"
 #include "../include/mlfq.hpp"
 
 namespace scheduler {
-u32
-mlfq::cpudiff(const struct rusage *cur, const struct rusage *prev) 
-const noexcept
+/* acquire task_mtx, accumulating the time spent blocked on it */
+template<u32 N, typename Q>
+void
+basic_mlfq<N, Q>::lock() noexcept
 {
-    return ((cur->ru_utime.tv_sec * 1000) +
-            (cur->ru_utime.tv_usec / 1000) +
-            (cur->ru_stime.tv_sec * 1000) +
-            (cur->ru_stime.tv_usec / 1000)) -
-           ((prev->ru_utime.tv_sec * 1000) +
-            (prev->ru_utime.tv_usec / 1000) +
-            (prev->ru_stime.tv_sec * 1000) +
-            (prev->ru_stime.tv_usec / 1000));
+    if (u64 ns = overhead::lock(&task_mtx))
+        t_lockwait.fetch_add(ns);
 }
- 
+
+template<u32 N, typename Q>
 void
-mlfq::schedule(task *t, u32 lvl) noexcept
+basic_mlfq<N, Q>::schedule(task *t, u32 lvl) noexcept
 {
+    OVERHEAD_START(t_dequeue);
     const task_state state = t->get_state();
-    const struct rusage *prev = t->get_rusage();
     struct rusage cur;
     
     switch (state) {
@@ -47,9 +48,7 @@ mlfq::schedule(task *t, u32 lvl) noexcept
     case task_state::RUNNABLE:
         t->set_t_firstrun(high_resolution_clock::now());
         t->run();
-        pthread_mutex_lock(&io_mtx);
-        std::cout << *t << " started\n";
-        pthread_mutex_unlock(&io_mtx);
+        LOG(INFO, STARTED, t, 0);
         break;
     /* task was descheduled and now resuming */
     case task_state::STOPPED:
@@ -64,14 +63,13 @@ mlfq::schedule(task *t, u32 lvl) noexcept
         err(EXIT_FAILURE, "unexpected task state");
     }
     t->set_state(task_state::RUNNING);
+    OVERHEAD_SINCE(DISPATCH, t_dequeue);
+    TRACE(DISPATCH, t->get_task_id(), lvl);
     
-    /* let task run for its timeslice */
-    usleep(TIMESLICE_US(lvl));
-    kill(t->get_pid(), SIGSTOP);
-
-    int rc, wstat;
-    if ((rc = wait4(t->get_pid(), &wstat, WUNTRACED, &cur)) < 0)
-        err(EXIT_FAILURE, "wait4");
+    /* let task run for its timeslice, or until it exits */
+    slice_timer st(Q::us(lvl), lvl);
+    st.wait(t);
+    int wstat = st.stop(t, &cur);
     
     /* child process exited */
     if (WIFEXITED(wstat)) {
@@ -79,23 +77,28 @@ mlfq::schedule(task *t, u32 lvl) noexcept
         t->set_state(task_state::FINISHED);
         t->set_t_completion(high_resolution_clock::now());
         t->set_rusage(&cur);
+        TRACE(EXIT, t->get_task_id(), lvl);
 
-        pthread_mutex_lock(&io_mtx);
-        std::cout << *t << " exited\n";
-        pthread_mutex_unlock(&io_mtx);
+        LOG(INFO, EXITED, t, 0);
+        aggregator::retire(t);
     } 
     /* child process was stopped from the stop signal */
     else if (WIFSTOPPED(wstat) && WSTOPSIG(wstat) == SIGSTOP) {
         t->set_state(task_state::STOPPED);
         t->set_t_laststop(high_resolution_clock::now());
+        TRACE(PREEMPT, t->get_task_id(), lvl);
         /* 
          *  If the process has accumulated more than a timeslice
          *  in cpu time at the queue level than demote it
          *  to a lower queue level
          */
-        if (cpudiff(prev, &cur) >= TIMESLICE_MS(lvl)) {
-            t->set_rusage(&cur);
-            enqueue(t, (lvl < tasks.size() - 1) ? lvl + 1 : lvl);
+        if (t->get_t_cpu_since_mark() >= microseconds(Q::us(lvl))) {
+            t->mark_t_cpu();
+            if (lvl < N - 1) {
+                TRACE(DEMOTE, t->get_task_id(), lvl + 1);
+                LOG(DEBUG, DEMOTED, t, lvl + 1);
+            }
+            enqueue(t, (lvl < N - 1) ? lvl + 1 : lvl);
         } else {
             /* 
              *  keep task on same queue level if it did not consume its
@@ -106,49 +109,40 @@ mlfq::schedule(task *t, u32 lvl) noexcept
     }
 }
 
-void *
-mlfq::prioboostworker(void *arg) noexcept
+/*
+ *  Caller holds task_mtx. Apply a boost if a PRIOBOOSTFREQ_US epoch began
+ *  since the last dispatch; several missed epochs are one boost
+ */
+template<u32 N, typename Q>
+void
+basic_mlfq<N, Q>::age() noexcept
 {
-    mlfq *m = (mlfq *)arg;
-    bool empty;
-    while (1) {
-        usleep(PRIOBOOSTFREQ_US);
-        empty = true;
-        pthread_mutex_lock(&(m->task_mtx));
-        /* migrate all tasks to the top priority level */
-        for (u32 lvl = 1; lvl < m->tasks.size(); ++lvl) {
-            if (!m->tasks[lvl].empty()) {
-                empty = false;
-                while (!m->tasks[lvl].empty()) {
-                    m->tasks[0].push(m->tasks[lvl].front());
-                    m->tasks[lvl].pop();
-                }
-            }
-        }
-        pthread_mutex_unlock(&(m->task_mtx));
-        if (empty && MLFQ_STOP(m->flag.load()))
-            break;
-    }
-    return nullptr;
+    u64 e = duration_cast<microseconds>(
+        steady_clock::now() - t_epoch
+    ).count() / PRIOBOOSTFREQ_US;
+    if (e == epoch)
+        return;
+    epoch = e;
+    tasks.boost();
+    TRACE(BOOST, 0, 0);
 }
 
+template<u32 N, typename Q>
 void *
-mlfq::schedworker(void *arg) noexcept
+basic_mlfq<N, Q>::schedworker(void *arg) noexcept
 {
-    mlfq *m = (mlfq *)arg;
+    basic_mlfq *m = (basic_mlfq *)arg;
     task *t;
     u32 lvl;
     do {
         t = nullptr;
+        OVERHEAD_START(t_idle);
         sem_wait(&(m->sem));
-        pthread_mutex_lock(&(m->task_mtx));
-        for (lvl = 0; lvl < m->tasks.size(); ++lvl) {
-            if (m->tasks[lvl].empty())
-                continue;
-            t = m->tasks[lvl].front();
-            m->tasks[lvl].pop();
-            break;
-        }
+        OVERHEAD_SINCE(SEM_WAIT, t_idle);
+        m->lock();
+        m->age();
+        /* find-first-set over the non-empty levels */
+        m->tasks.pop(&t, &lvl);
         pthread_mutex_unlock(&(m->task_mtx));
         if (t)
             m->schedule(t, lvl);
@@ -159,16 +153,19 @@ mlfq::schedworker(void *arg) noexcept
     return nullptr;
 }
 
-mlfq::mlfq(u32 ncpus) noexcept
+template<u32 N, typename Q>
+basic_mlfq<N, Q>::basic_mlfq(u32 ncpus) noexcept
     : ncpus(ncpus),
-      flag(0)
+      flag(0),
+      t_lockwait(0),
+      t_epoch(steady_clock::now()),
+      epoch(0)
 {
     pthread_mutex_init(&task_mtx, nullptr);
-    pthread_mutex_init(&io_mtx, nullptr);
     sem_init(&sem, 0, 0);
     
-    /* one scheduler thread per cpu + priority boost thread */
-    threads = (pthread_t *)malloc(sizeof(pthread_t) * (ncpus + 1));
+    /* one scheduler thread per cpu */
+    threads = (pthread_t *)malloc(sizeof(pthread_t) * ncpus);
     cpu_set_t cpus;
     CPU_ZERO(&cpus);
 
@@ -180,12 +177,11 @@ mlfq::mlfq(u32 ncpus) noexcept
             err(EXIT_FAILURE, "pthread_setaffinity_np");
         CPU_CLR(i, &cpus);
     }
-    
-    pthread_create(threads + ncpus, nullptr, prioboostworker, this);
 }
 
 /* join all threads and clean up all resources */
-mlfq::~mlfq() noexcept
+template<u32 N, typename Q>
+basic_mlfq<N, Q>::~basic_mlfq() noexcept
 {
     flag.fetch_or(MLFQ_STOP_FLAG);
     for (u32 i = 0; i < ncpus; ++i)
@@ -193,19 +189,26 @@ mlfq::~mlfq() noexcept
     for (u32 i = 0; i < ncpus; ++i)
         pthread_join(threads[i], nullptr);
     
-    pthread_join(threads[ncpus], nullptr);
+    std::cout << "\nMLFQ Lock Wait Time:\t\t\t"
+              << t_lockwait.load() / 1e6 << "ms\n"
+              << "MLFQ Priority Boosts:\t\t\t"
+              << tasks.get_nr_boosts() << '\n';
     pthread_mutex_destroy(&task_mtx);
-    pthread_mutex_destroy(&io_mtx);
     sem_destroy(&sem);
     free(threads);
 }
 
+template<u32 N, typename Q>
 void
-mlfq::enqueue(task *t, u32 lvl) noexcept
+basic_mlfq<N, Q>::enqueue(task *t, u32 lvl) noexcept
 {
-    pthread_mutex_lock(&task_mtx);
-    tasks[lvl].push(t);
+    lock();
+    tasks.push(t, lvl);
     sem_post(&sem);
     pthread_mutex_unlock(&task_mtx);
 }
+
+template class basic_mlfq<>;
+template class basic_mlfq<64, linear_quantum<5000, 320000>>;
+template class basic_mlfq<140, linear_quantum<2000, 280000>>;
 } // namespace scheduler
@@ -0,0 +1,53 @@
+/* overhead.cpp Per-Thread Scheduler Self-Overhead Histograms */
+#include <chrono>
+#include <vector>
+#include <pthread.h>
+#include "../include/types.hpp"
+#include "../include/histogram.hpp"
+#include "../include/registry.hpp"
+#include "../include/overhead.hpp"
+
+thread_registry<overhead::shard> overhead::shards;
+
+void
+overhead::record(ovh_metric m, u64 ns) noexcept
+{
+    shards.local().hist[(u32)m].record(ns);
+}
+
+u64
+overhead::lock(pthread_mutex_t *m) noexcept
+{
+    if (pthread_mutex_trylock(m) == 0) {
+        OVERHEAD_RECORD(LOCK_WAIT, 0);
+        return 0;
+    }
+    auto t0 = steady_clock::now();
+    pthread_mutex_lock(m);
+    u64 ns = duration_cast<nanoseconds>(steady_clock::now() - t0).count();
+    OVERHEAD_RECORD(LOCK_WAIT, ns);
+    return ns;
+}
+
+void
+overhead::merge(ovh_metric m, histogram *out) noexcept
+{
+    shards.for_each([&](const shard &s) {
+        out->merge(s.hist[(u32)m]);
+    });
+}
+
+std::vector<u64>
+overhead::per_thread() noexcept
+{
+    std::vector<u64> busy;
+    shards.for_each([&](const shard &s) {
+        double ns = 0;
+        for (u32 m = 0; m < (u32)ovh_metric::NR; ++m)
+            if (m != (u32)ovh_metric::SEM_WAIT)
+                ns += s.hist[m].mean() * s.hist[m].count();
+        if (ns > 0)
+            busy.push_back((u64)ns);
+    });
+    return busy;
+}
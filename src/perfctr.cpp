@@ -0,0 +1,166 @@
+/* perfctr.cpp Per-Task Performance Counters */
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <linux/perf_event.h>
+#include "../include/types.hpp"
+#include "../include/perfctr.hpp"
+
+std::atomic<u8>     perfctr::src((u8)perfctr_source::HARDWARE);
+std::atomic<bool>   perfctr::user_only(false);
+
+/* type and config of every counter, in perf_counter order */
+static const struct {
+    u32     type;
+    u64     config;
+} events[(u32)perf_counter::NR] = {
+    { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK },
+    { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES },
+    { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_MIGRATIONS },
+    { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES }
+};
+
+perf_counters::perf_counters() noexcept
+{
+    for (u32 i = 0; i < (u32)perf_counter::NR; ++i) {
+        fd[i] = -1;
+        val[i] = 0;
+    }
+}
+
+static int
+open_event(u32 i, pid_t pid, int group, bool exclude_kernel) noexcept
+{
+    struct perf_event_attr attr = {};
+    attr.size = sizeof(attr);
+    attr.type = events[i].type;
+    attr.config = events[i].config;
+    attr.exclude_kernel = exclude_kernel;
+    attr.exclude_hv = 1;
+    if (group < 0)
+        attr.read_format = PERF_FORMAT_GROUP |
+                           PERF_FORMAT_TOTAL_TIME_ENABLED |
+                           PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return syscall(SYS_perf_event_open, &attr, pid, -1, group,
+                   PERF_FLAG_FD_CLOEXEC);
+}
+
+/*
+ *  The task clock leads the group; when it cannot be opened for lack of
+ *  permission, counting stops for good. Software members follow, then the
+ *  hardware ones, the first of which to fail for lack of a PMU turns them
+ *  off for every later task. Any other failure (e.g. out of fds) leaves
+ *  just this task without counters
+ */
+void
+perfctr::attach(perf_counters *pc, pid_t pid) noexcept
+{
+    if (source() == perfctr_source::NONE)
+        return;
+
+    const u32 leader = (u32)perf_counter::TASK_CLOCK;
+    pc->fd[leader] = open_event(leader, pid, -1, user_only.load());
+    if (pc->fd[leader] < 0 && errno == EACCES && !user_only.load()) {
+        user_only.store(true);
+        pc->fd[leader] = open_event(leader, pid, -1, true);
+    }
+    if (pc->fd[leader] < 0) {
+        if (errno == EACCES || errno == EPERM || errno == ENOSYS)
+            src.store((u8)perfctr_source::NONE);
+        return;
+    }
+
+    for (u32 i = leader + 1; i < (u32)perf_counter::NR; ++i) {
+        bool hw = events[i].type == PERF_TYPE_HARDWARE;
+        if (hw && source() != perfctr_source::HARDWARE)
+            break;
+        pc->fd[i] = open_event(i, pid, pc->fd[leader],
+                               hw || user_only.load());
+        if (pc->fd[i] >= 0)
+            continue;
+        if (!hw || (errno != ENOENT && errno != EOPNOTSUPP &&
+                    errno != ENODEV && errno != EINVAL)) {
+            detach(pc);
+            return;
+        }
+        /* no PMU: keep the software counters only */
+        src.store((u8)perfctr_source::SOFTWARE);
+        for (u32 j = (u32)perf_counter::INSTRUCTIONS; j < i; ++j) {
+            close(pc->fd[j]);
+            pc->fd[j] = -1;
+        }
+        break;
+    }
+}
+
+/*
+ *  Values come in group order, the leader then the members in the order
+ *  they were opened. If the PMU had to multiplex the group, the totals
+ *  are scaled up to the time it was enabled
+ */
+void
+perfctr::read(perf_counters *pc) noexcept
+{
+    const u32 leader = (u32)perf_counter::TASK_CLOCK;
+    if (pc->fd[leader] < 0)
+        return;
+    struct {
+        u64 nr;
+        u64 t_enabled;
+        u64 t_running;
+        u64 values[(u32)perf_counter::NR];
+    } buf;
+    ssize_t n = ::read(pc->fd[leader], &buf, sizeof(buf));
+    if (n < (ssize_t)(3 * sizeof(u64)) || !buf.t_running)
+        return;
+
+    double scale = (double)buf.t_enabled / buf.t_running;
+    for (u32 i = 0, v = 0; i < (u32)perf_counter::NR && v < buf.nr; ++i) {
+        if (pc->fd[i] < 0)
+            continue;
+        u64 x = buf.values[v++];
+        pc->val[i] = (scale > 1.0) ? (u64)(x * scale) : x;
+    }
+}
+
+void
+perfctr::detach(perf_counters *pc) noexcept
+{
+    for (u32 i = 0; i < (u32)perf_counter::NR; ++i) {
+        if (pc->fd[i] >= 0)
+            close(pc->fd[i]);
+        pc->fd[i] = -1;
+    }
+}
+
+bool
+perfctr::opened(const perf_counters &pc, perf_counter c) noexcept
+{
+    return pc.fd[(u32)c] >= 0;
+}
+
+perfctr_source
+perfctr::source() noexcept
+{
+    return (perfctr_source)src.load(std::memory_order_relaxed);
+}
+
+const char *
+perfctr::name(perfctr_source src) noexcept
+{
+    switch (src) {
+    case perfctr_source::HARDWARE:
+        return "hardware";
+    case perfctr_source::SOFTWARE:
+        return "software only";
+    case perfctr_source::NONE:
+        return "none";
+    }
+    return "unknown";
+}
@@ -0,0 +1,211 @@
+/* pmlfq.cpp Per-CPU Multi-Level Feedback Queue Scheduler */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <iostream>
+#include <atomic>
+#include <cassert>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <sys/sysinfo.h>
+#include <sys/time.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <err.h>
+#include "../include/types.hpp"
+#include "../include/task.hpp"
+#include "../include/aggregator.hpp"
+#include "../include/logger.hpp"
+#include "../include/overhead.hpp"
+#include "../include/timer.hpp"
+#include "../include/trace.hpp"
+#include "../include/pmlfq.hpp"
+
+namespace scheduler {
+/*
+ *  Caller holds rq.mtx. Apply a boost if a PRIOBOOSTFREQ_US epoch began
+ *  since rq was last popped from; several missed epochs are one boost
+ */
+template<u32 N, typename Q>
+void
+basic_pmlfq<N, Q>::age(runqueue &rq) noexcept
+{
+    u64 e = duration_cast<microseconds>(
+        steady_clock::now() - t_epoch
+    ).count() / PRIOBOOSTFREQ_US;
+    if (e == rq.epoch)
+        return;
+    rq.epoch = e;
+    rq.tasks.boost();
+    TRACE(BOOST, 0, rq.cpu);
+}
+
+/* pop the front task of the highest priority non-empty level of rq */
+template<u32 N, typename Q>
+task *
+basic_pmlfq<N, Q>::pop(runqueue &rq, u32 *lvl) noexcept
+{
+    task *t = nullptr;
+    lock(rq, &rq.t_lockwait);
+    age(rq);
+    if (rq.tasks.pop(&t, lvl))
+        rq.nr_queued--;
+    pthread_mutex_unlock(&rq.mtx);
+    return t;
+}
+
+/*
+ *  Walk the other run queues starting after our own cpu and take the
+ *  front task of the highest priority non-empty level of the first victim
+ *  that has any queued work
+ */
+template<u32 N, typename Q>
+task *
+basic_pmlfq<N, Q>::steal(runqueue &self, u32 *lvl) noexcept
+{
+    for (u32 i = 1; i < ncpus; ++i) {
+        runqueue &victim = rqs[(self.cpu + i) % ncpus];
+        if (victim.nr_queued.load() == 0)
+            continue;
+        task *t = nullptr;
+        lock(victim, &self.t_lockwait);
+        age(victim);
+        if (victim.tasks.pop(&t, lvl))
+            victim.nr_queued--;
+        pthread_mutex_unlock(&victim.mtx);
+        if (t) {
+            self.nr_steals++;
+            TRACE(STEAL, t->get_task_id(), victim.cpu);
+            LOG(DEBUG, STOLEN, t, self.cpu);
+            return t;
+        }
+    }
+    return nullptr;
+}
+
+template<u32 N, typename Q>
+void
+basic_pmlfq<N, Q>::push(runqueue &rq, task *t, u32 lvl, u64 *t_wait) noexcept
+{
+    lock(rq, t_wait);
+    rq.tasks.push(t, lvl);
+    rq.nr_queued++;
+    pthread_mutex_unlock(&rq.mtx);
+    wake(rq);
+}
+
+template<u32 N, typename Q>
+void
+basic_pmlfq<N, Q>::schedule(runqueue &self, task *t, u32 lvl) noexcept
+{
+    OVERHEAD_START(t_dequeue);
+    const task_state state = t->get_state();
+    struct rusage cur;
+
+    switch (state) {
+    case task_state::RUNNABLE:
+        t->set_t_firstrun(high_resolution_clock::now());
+        t->run();
+        LOG(INFO, STARTED, t, 0);
+        break;
+    case task_state::STOPPED:
+        t->increment_t_waiting(high_resolution_clock::now());
+        kill(t->get_pid(), SIGCONT);
+        break;
+    default:
+        err(EXIT_FAILURE, "unexpected task state");
+    }
+    t->set_state(task_state::RUNNING);
+    OVERHEAD_SINCE(DISPATCH, t_dequeue);
+    TRACE(DISPATCH, t->get_task_id(), lvl);
+
+    /* let task run for its timeslice, or until it exits */
+    slice_timer st(Q::us(lvl), lvl);
+    st.wait(t);
+    int wstat = st.stop(t, &cur);
+
+    if (WIFEXITED(wstat)) {
+        assert(WEXITSTATUS(wstat) == 0);
+        t->set_state(task_state::FINISHED);
+        t->set_t_completion(high_resolution_clock::now());
+        t->set_rusage(&cur);
+        TRACE(EXIT, t->get_task_id(), lvl);
+
+        LOG(INFO, EXITED, t, 0);
+        aggregator::retire(t);
+    } else if (WIFSTOPPED(wstat) && WSTOPSIG(wstat) == SIGSTOP) {
+        t->set_state(task_state::STOPPED);
+        t->set_t_laststop(high_resolution_clock::now());
+        TRACE(PREEMPT, t->get_task_id(), lvl);
+        /* requeue on the local cpu, demoting if the slice was used up */
+        if (t->get_t_cpu_since_mark() >= microseconds(Q::us(lvl))) {
+            t->mark_t_cpu();
+            if (lvl < N - 1) {
+                lvl++;
+                TRACE(DEMOTE, t->get_task_id(), lvl);
+                LOG(DEBUG, DEMOTED, t, lvl);
+            }
+        }
+        push(self, t, lvl, &self.t_lockwait);
+        kick(self);
+    }
+}
+
+/* run the next task of self, or one stolen from another cpu */
+template<u32 N, typename Q>
+bool
+basic_pmlfq<N, Q>::dispatch(runqueue &self) noexcept
+{
+    u32 lvl;
+    task *t = pop(self, &lvl);
+    if (!t && !(t = steal(self, &lvl)))
+        return false;
+    self.nr_dispatch++;
+    schedule(self, t, lvl);
+    return true;
+}
+
+template<u32 N, typename Q>
+basic_pmlfq<N, Q>::basic_pmlfq(u32 ncpus) noexcept
+    : base(ncpus, PMLFQ_IDLE_WAIT_US),
+      t_epoch(steady_clock::now())
+{
+    for (u32 i = 0; i < ncpus; ++i) {
+        rqs[i].epoch = 0;
+        rqs[i].nr_steals = 0;
+    }
+    start();
+}
+
+/* join all threads and report per-cpu statistics */
+template<u32 N, typename Q>
+basic_pmlfq<N, Q>::~basic_pmlfq() noexcept
+{
+    stop();
+
+    u64 nr_steals = 0, nr_boosts = 0;
+    report("MLFQ", [&](const runqueue &rq) {
+        std::cout << rq.nr_steals << " steals, "
+                  << rq.tasks.get_nr_boosts() << " boosts, ";
+        nr_steals += rq.nr_steals;
+        nr_boosts += rq.tasks.get_nr_boosts();
+    }, [&] {
+        std::cout << "Total Steals:\t\t\t\t" << nr_steals << '\n'
+                  << "Total Priority Boosts:\t\t\t" << nr_boosts << '\n';
+    });
+}
+
+template<u32 N, typename Q>
+void
+basic_pmlfq<N, Q>::enqueue(task *t, u32 lvl) noexcept
+{
+    push(place(false), t, lvl, nullptr);
+}
+
+template class basic_pmlfq<>;
+template class basic_pmlfq<64, linear_quantum<5000, 320000>>;
+template class basic_pmlfq<140, linear_quantum<2000, 280000>>;
+} // namespace scheduler
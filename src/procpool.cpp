@@ -0,0 +1,136 @@
+#include <atomic>
+#include <condition_variable>
+#include <initializer_list>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+#include <cstring>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include <err.h>
+#include "../include/types.hpp"
+#include "../include/launcher.hpp"
+#include "../include/procpool.hpp"
+
+std::vector<procpool::entry>    procpool::pools;
+u32                             procpool::size = 0;
+std::mutex                      procpool::mtx;
+std::condition_variable         procpool::cv;
+std::thread                     procpool::refiller;
+bool                            procpool::stop = false;
+std::atomic<u64>                procpool::hits(0);
+std::atomic<u64>                procpool::misses(0);
+
+/* caller holds mtx */
+bool
+procpool::needs_refill() noexcept
+{
+    for (entry &e : pools)
+        if (e.pids.size() < size)
+            return true;
+    return false;
+}
+
+/* background thread: top every pool back up to its target size */
+void
+procpool::refill() noexcept
+{
+    std::unique_lock<std::mutex> lk(mtx);
+    while (true) {
+        cv.wait(lk, []{ return stop || needs_refill(); });
+        if (stop)
+            return;
+        for (entry &e : pools) {
+            while (!stop && e.pids.size() < size) {
+                lk.unlock();
+                pid_t pid = launcher::spawn(e.path, e.argv, true);
+                lk.lock();
+                e.pids.push(pid);
+            }
+        }
+    }
+}
+
+/*
+ *  Register the workload binaries and start filling their pools. A size
+ *  of 0 disables pooling. Call after launcher::init so the refill thread
+ *  uses the selected launch method
+ */
+void
+procpool::init(u32 sz, std::initializer_list<const char *> paths) noexcept
+{
+    size = sz;
+    if (size == 0)
+        return;
+    pools.reserve(paths.size());
+    for (const char *path : paths) {
+        entry &e = pools.emplace_back();
+        e.path = path;
+        e.argv[0] = const_cast<char *>(path);
+        e.argv[1] = nullptr;
+    }
+    refiller = std::thread(refill);
+}
+
+/* stop refilling and kill and reap all parked processes */
+void
+procpool::shutdown() noexcept
+{
+    if (!refiller.joinable())
+        return;
+    {
+        std::lock_guard<std::mutex> lk(mtx);
+        stop = true;
+    }
+    cv.notify_one();
+    refiller.join();
+    for (entry &e : pools) {
+        while (!e.pids.empty()) {
+            kill(e.pids.front(), SIGKILL);
+            waitpid(e.pids.front(), nullptr, 0);
+            e.pids.pop();
+        }
+    }
+}
+
+bool
+procpool::enabled() noexcept
+{
+    return size > 0;
+}
+
+/*
+ *  Start a process of the given workload binary: hand out and continue a
+ *  parked one if its pool has any, otherwise launch a new one directly
+ */
+pid_t
+procpool::launch(const char *path) noexcept
+{
+    pid_t pid = -1;
+    if (enabled()) {
+        std::lock_guard<std::mutex> lk(mtx);
+        for (entry &e : pools) {
+            if (strcmp(e.path, path))
+                continue;
+            if (!e.pids.empty()) {
+                pid = e.pids.front();
+                e.pids.pop();
+            }
+            break;
+        }
+    }
+    if (pid > 0) {
+        hits++;
+        kill(pid, SIGCONT);
+        cv.notify_one();
+        return pid;
+    }
+    if (enabled()) {
+        misses++;
+        cv.notify_one();
+    }
+    char *argv[] = { const_cast<char *>(path), nullptr };
+    return launcher::spawn(path, argv);
+}
@@ -0,0 +1,266 @@
+/* rbtree.cpp Intrusive Red-Black Tree */
+#include "../include/types.hpp"
+#include "../include/rbtree.hpp"
+
+rb_tree::rb_tree(rb_augment_fn augment) noexcept
+    : root(nullptr),
+      leftmost(nullptr),
+      nr_nodes(0),
+      augment(augment)
+{}
+
+bool
+rb_tree::empty() const noexcept
+{
+    return root == nullptr;
+}
+
+u64
+rb_tree::size() const noexcept
+{
+    return nr_nodes;
+}
+
+rb_node *
+rb_tree::top() const noexcept
+{
+    return root;
+}
+
+rb_node *
+rb_tree::first() const noexcept
+{
+    return leftmost;
+}
+
+rb_node *
+rb_tree::last() const noexcept
+{
+    rb_node *n = root;
+    while (n && n->right)
+        n = n->right;
+    return n;
+}
+
+/* in-order successor of n, or nullptr if n is the last node */
+rb_node *
+rb_tree::next(const rb_node *n) noexcept
+{
+    if (n->right) {
+        n = n->right;
+        while (n->left)
+            n = n->left;
+        return const_cast<rb_node *>(n);
+    }
+    rb_node *p;
+    while ((p = n->parent) && n == p->right)
+        n = p;
+    return p;
+}
+
+void
+rb_tree::replace_child(rb_node *parent, rb_node *old, rb_node *n) noexcept
+{
+    if (!parent)
+        root = n;
+    else if (parent->left == old)
+        parent->left = n;
+    else
+        parent->right = n;
+}
+
+/* recompute the augmented value of n and all of its ancestors */
+void
+rb_tree::propagate(rb_node *n) noexcept
+{
+    if (!augment)
+        return;
+    for (; n; n = n->parent)
+        augment(n);
+}
+
+/* rotations keep the subtree above them intact, so only x and y change */
+void
+rb_tree::rotate_left(rb_node *x) noexcept
+{
+    rb_node *y = x->right;
+    x->right = y->left;
+    if (y->left)
+        y->left->parent = x;
+    y->parent = x->parent;
+    replace_child(x->parent, x, y);
+    y->left = x;
+    x->parent = y;
+    if (augment) {
+        augment(x);
+        augment(y);
+    }
+}
+
+void
+rb_tree::rotate_right(rb_node *x) noexcept
+{
+    rb_node *y = x->left;
+    x->left = y->right;
+    if (y->right)
+        y->right->parent = x;
+    y->parent = x->parent;
+    replace_child(x->parent, x, y);
+    y->right = x;
+    x->parent = y;
+    if (augment) {
+        augment(x);
+        augment(y);
+    }
+}
+
+void
+rb_tree::insert_fixup(rb_node *n) noexcept
+{
+    rb_node *p, *g, *u;
+    while ((p = n->parent) && p->red) {
+        g = p->parent;
+        if (p == g->left) {
+            u = g->right;
+            if (u && u->red) {
+                p->red = u->red = false;
+                g->red = true;
+                n = g;
+                continue;
+            }
+            if (n == p->right) {
+                rotate_left(p);
+                n = p;
+                p = n->parent;
+            }
+            p->red = false;
+            g->red = true;
+            rotate_right(g);
+        } else {
+            u = g->left;
+            if (u && u->red) {
+                p->red = u->red = false;
+                g->red = true;
+                n = g;
+                continue;
+            }
+            if (n == p->left) {
+                rotate_right(p);
+                n = p;
+                p = n->parent;
+            }
+            p->red = false;
+            g->red = true;
+            rotate_left(g);
+        }
+    }
+    root->red = false;
+}
+
+/* restore the black height after removing a black node above x */
+void
+rb_tree::erase_fixup(rb_node *x, rb_node *parent) noexcept
+{
+    rb_node *w;
+    while (x != root && (!x || !x->red)) {
+        if (x == parent->left) {
+            w = parent->right;
+            if (w->red) {
+                w->red = false;
+                parent->red = true;
+                rotate_left(parent);
+                w = parent->right;
+            }
+            if ((!w->left || !w->left->red) &&
+                (!w->right || !w->right->red)) {
+                w->red = true;
+                x = parent;
+                parent = x->parent;
+                continue;
+            }
+            if (!w->right || !w->right->red) {
+                w->left->red = false;
+                w->red = true;
+                rotate_right(w);
+                w = parent->right;
+            }
+            w->red = parent->red;
+            parent->red = false;
+            w->right->red = false;
+            rotate_left(parent);
+        } else {
+            w = parent->left;
+            if (w->red) {
+                w->red = false;
+                parent->red = true;
+                rotate_right(parent);
+                w = parent->left;
+            }
+            if ((!w->left || !w->left->red) &&
+                (!w->right || !w->right->red)) {
+                w->red = true;
+                x = parent;
+                parent = x->parent;
+                continue;
+            }
+            if (!w->left || !w->left->red) {
+                w->right->red = false;
+                w->red = true;
+                rotate_left(w);
+                w = parent->left;
+            }
+            w->red = parent->red;
+            parent->red = false;
+            w->left->red = false;
+            rotate_right(parent);
+        }
+        x = root;
+    }
+    if (x)
+        x->red = false;
+}
+
+void
+rb_tree::erase(rb_node *n) noexcept
+{
+    if (n == leftmost)
+        leftmost = next(n);
+
+    rb_node *x, *parent;
+    bool red;
+    if (!n->left || !n->right) {
+        /* at most one child: splice n out */
+        x = n->left ? n->left : n->right;
+        parent = n->parent;
+        red = n->red;
+        if (x)
+            x->parent = parent;
+        replace_child(parent, n, x);
+    } else {
+        /* two children: move the successor y into n's position */
+        rb_node *y = n->right;
+        while (y->left)
+            y = y->left;
+        x = y->right;
+        red = y->red;
+        if (y->parent == n) {
+            parent = y;
+        } else {
+            parent = y->parent;
+            parent->left = x;
+            if (x)
+                x->parent = parent;
+            y->right = n->right;
+            n->right->parent = y;
+        }
+        y->left = n->left;
+        n->left->parent = y;
+        y->parent = n->parent;
+        y->red = n->red;
+        replace_child(n->parent, n, y);
+    }
+    nr_nodes--;
+    propagate(parent);
+    if (!red)
+        erase_fixup(x, parent);
+}
@@ -0,0 +1,278 @@
+/* reactor.cpp Event Driven Round Robin Engine */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <iostream>
+#include <queue>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <algorithm>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <sys/wait.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <signal.h>
+#include <err.h>
+#include <cassert>
+#include <cerrno>
+#include "../include/types.hpp"
+#include "../include/task.hpp"
+#include "../include/aggregator.hpp"
+#include "../include/logger.hpp"
+#include "../include/overhead.hpp"
+#include "../include/timer.hpp"
+#include "../include/latency.hpp"
+#include "../include/reactor.hpp"
+
+/* epoll_event.data.u64 = (event kind << 32) | slot index */
+#define EV_WAKE         0x0ULL
+#define EV_TIMER        0x1ULL
+#define EV_EXIT         0x2ULL
+#define EV_TAG(k, i)    (((k) << 32) | (i))
+#define EV_KIND(u)      ((u) >> 32)
+#define EV_SLOT(u)      ((u32)((u) & 0xffffffff))
+
+namespace scheduler {
+/* start or resume t in slot i and arm the slot's slice deadline */
+void
+reactor::dispatch(loop &l, u32 i, task *t) noexcept
+{
+    OVERHEAD_START(t_dequeue);
+    switch (t->get_state()) {
+    case task_state::RUNNABLE:
+        t->set_t_firstrun(high_resolution_clock::now());
+        t->run();
+        LOG(INFO, STARTED, t, 0);
+        break;
+    case task_state::STOPPED:
+        t->increment_t_waiting(high_resolution_clock::now());
+        kill(t->get_pid(), SIGCONT);
+        break;
+    default:
+        err(EXIT_FAILURE, "unexpected task state");
+    }
+    t->set_state(task_state::RUNNING);
+    OVERHEAD_SINCE(DISPATCH, t_dequeue);
+
+    l.slots[i].t_deadline = steady_clock::now() + 
+                            microseconds(RR_TIMESLICE_US);
+    auto ns = duration_cast<nanoseconds>(
+        l.slots[i].t_deadline.time_since_epoch()
+    );
+    struct itimerspec its = {};
+    its.it_value.tv_sec = ns.count() / 1000000000;
+    its.it_value.tv_nsec = ns.count() % 1000000000;
+    if (timerfd_settime(l.slots[i].tfd, TFD_TIMER_ABSTIME, &its, nullptr) < 0)
+        err(EXIT_FAILURE, "timerfd_settime");
+
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.u64 = EV_TAG(EV_EXIT, i);
+    if (epoll_ctl(l.epfd, EPOLL_CTL_ADD, t->get_pidfd(), &ev) < 0)
+        err(EXIT_FAILURE, "epoll_ctl");
+
+    l.slots[i].t = t;
+    l.nr_running++;
+}
+
+/* disarm slot i and stop watching its task */
+void
+reactor::release(loop &l, u32 i) noexcept
+{
+    struct itimerspec its = {};
+    timerfd_settime(l.slots[i].tfd, 0, &its, nullptr);
+    epoll_ctl(l.epfd, EPOLL_CTL_DEL, l.slots[i].t->get_pidfd(), nullptr);
+    l.slots[i].t = nullptr;
+    l.nr_running--;
+}
+
+/* the slice of slot i expired: stop the task and requeue it locally */
+void
+reactor::preempt(loop &l, u32 i) noexcept
+{
+    task *t = l.slots[i].t;
+    OVERHEAD_START(t_kill);
+    kill(t->get_pid(), SIGSTOP);
+
+    struct rusage ru;
+    int wstat;
+    if (wait4(t->get_pid(), &wstat, WUNTRACED, &ru) < 0)
+        err(EXIT_FAILURE, "wait4");
+    auto t_stopped = steady_clock::now();
+    if (WIFSTOPPED(wstat)) {
+        OVERHEAD_RECORD(STOP, duration_cast<nanoseconds>(
+            t_stopped - t_kill
+        ).count());
+        u64 ns = duration_cast<nanoseconds>(
+            std::max(t_stopped - l.slots[i].t_deadline,
+                     steady_clock::duration(0))
+        ).count();
+        latency::record(lat_metric::OVERSHOOT, t->get_kind(), ns);
+    }
+
+    t->set_rusage(&ru);
+    t->account(&ru);
+    release(l, i);
+    if (WIFEXITED(wstat)) {
+        t->set_state(task_state::FINISHED);
+        t->set_t_completion(high_resolution_clock::now());
+        LOG(INFO, EXITED, t, 0);
+        aggregator::retire(t);
+    } else if (WIFSTOPPED(wstat) && WSTOPSIG(wstat) == SIGSTOP) {
+        t->set_state(task_state::STOPPED);
+        t->set_t_laststop(high_resolution_clock::now());
+        l.ready.push(t);
+    }
+}
+
+/* the pidfd of slot i became readable: the task exited mid-slice */
+void
+reactor::reap(loop &l, u32 i) noexcept
+{
+    task *t = l.slots[i].t;
+    struct rusage ru;
+    int wstat;
+    if (wait4(t->get_pid(), &wstat, 0, &ru) < 0)
+        err(EXIT_FAILURE, "wait4");
+    assert(WIFEXITED(wstat) && WEXITSTATUS(wstat) == 0);
+
+    slice_timer::reclaim(t, l.slots[i].t_deadline);
+
+    t->set_rusage(&ru);
+    t->account(&ru);
+    t->set_state(task_state::FINISHED);
+    t->set_t_completion(high_resolution_clock::now());
+    release(l, i);
+    LOG(INFO, EXITED, t, 0);
+    aggregator::retire(t);
+}
+
+void
+reactor::run(loop &l) noexcept
+{
+    struct epoll_event evs[REACTOR_MAX_EVENTS];
+    u64 buf;
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lk(l.inbox_mtx);
+            while (!l.inbox.empty()) {
+                l.ready.push(l.inbox.front());
+                l.inbox.pop();
+            }
+        }
+        for (u32 i = 0; i < l.slots.size() && !l.ready.empty(); ++i) {
+            if (l.slots[i].t)
+                continue;
+            task *t = l.ready.front();
+            l.ready.pop();
+            dispatch(l, i, t);
+        }
+        if (l.nr_running == 0 && l.ready.empty() &&
+            REACTOR_STOP(flag.load()))
+        {
+            std::lock_guard<std::mutex> lk(l.inbox_mtx);
+            if (l.inbox.empty())
+                break;
+        }
+
+        int n = epoll_wait(l.epfd, evs, REACTOR_MAX_EVENTS, -1);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            err(EXIT_FAILURE, "epoll_wait");
+        }
+        /*
+         *  A slot is only refilled after the whole batch is handled, so an
+         *  event for an already emptied slot is stale and can be dropped
+         */
+        for (int e = 0; e < n; ++e) {
+            u64 tag = evs[e].data.u64;
+            u32 i = EV_SLOT(tag);
+            switch (EV_KIND(tag)) {
+            case EV_WAKE:
+                read(l.evfd, &buf, sizeof(buf));
+                break;
+            case EV_TIMER:
+                read(l.slots[i].tfd, &buf, sizeof(buf));
+                if (l.slots[i].t)
+                    preempt(l, i);
+                break;
+            case EV_EXIT:
+                if (l.slots[i].t)
+                    reap(l, i);
+                break;
+            }
+        }
+    }
+}
+
+reactor::reactor(u32 ncpus, u32 width) noexcept
+    : loops(ncpus), next(0), flag(0)
+{
+    cpu_set_t cpus;
+    for (u32 cpu = 0; cpu < ncpus; ++cpu) {
+        loop &l = loops[cpu];
+        l.nr_running = 0;
+        if ((l.epfd = epoll_create1(EPOLL_CLOEXEC)) < 0)
+            err(EXIT_FAILURE, "epoll_create1");
+        if ((l.evfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0)
+            err(EXIT_FAILURE, "eventfd");
+
+        struct epoll_event ev = {};
+        ev.events = EPOLLIN;
+        ev.data.u64 = EV_TAG(EV_WAKE, 0);
+        epoll_ctl(l.epfd, EPOLL_CTL_ADD, l.evfd, &ev);
+
+        l.slots.resize(width);
+        for (u32 i = 0; i < width; ++i) {
+            l.slots[i].t = nullptr;
+            l.slots[i].tfd = timerfd_create(CLOCK_MONOTONIC,
+                                            TFD_NONBLOCK | TFD_CLOEXEC);
+            if (l.slots[i].tfd < 0)
+                err(EXIT_FAILURE, "timerfd_create");
+            ev.data.u64 = EV_TAG(EV_TIMER, i);
+            epoll_ctl(l.epfd, EPOLL_CTL_ADD, l.slots[i].tfd, &ev);
+        }
+
+        l.thread = std::thread([this, &l]{ run(l); });
+        CPU_ZERO(&cpus);
+        CPU_SET(cpu, &cpus);
+        if (pthread_setaffinity_np(l.thread.native_handle(),
+                                   sizeof(cpu_set_t), &cpus) < 0)
+            err(EXIT_FAILURE, "pthread_setaffinity_np");
+    }
+}
+
+reactor::~reactor() noexcept
+{
+    u64 one = 1;
+    flag.fetch_or(REACTOR_STOP_FLAG);
+    for (loop &l : loops)
+        write(l.evfd, &one, sizeof(one));
+    for (loop &l : loops) {
+        assert(l.thread.joinable());
+        l.thread.join();
+        for (slot &s : l.slots)
+            close(s.tfd);
+        close(l.evfd);
+        close(l.epfd);
+    }
+}
+
+void
+reactor::enqueue(task *t) noexcept
+{
+    u64 one = 1;
+    loop &l = loops[next.fetch_add(1) % loops.size()];
+    {
+        std::lock_guard<std::mutex> lk(l.inbox_mtx);
+        l.inbox.push(t);
+    }
+    write(l.evfd, &one, sizeof(one));
+}
+} // namespace scheduler
@@ -13,6 +13,11 @@
 #include <cassert>
 #include "../include/types.hpp"
 #include "../include/task.hpp"
+#include "../include/aggregator.hpp"
+#include "../include/logger.hpp"
+#include "../include/overhead.hpp"
+#include "../include/timer.hpp"
+#include "../include/trace.hpp"
 #include "../include/rr.hpp"
 
 namespace scheduler {
@@ -22,11 +27,12 @@ rr::schedule(task *t) noexcept
     assert(t->get_state() != task_state::RUNNING ||
            t->get_state() != task_state::FINISHED);
     
+    OVERHEAD_START(t_dequeue);
     switch (t->get_state()) {
     case task_state::RUNNABLE:
         t->set_t_firstrun(high_resolution_clock::now());
         t->run();
-        std::cout << *t << " started\n";
+        LOG(INFO, STARTED, t, 0);
         break;
     case task_state::STOPPED:
         t->increment_t_waiting(high_resolution_clock::now());
@@ -36,47 +42,52 @@ rr::schedule(task *t) noexcept
         err(EXIT_FAILURE, "unexpected task state");
     }
     t->set_state(task_state::RUNNING);
+    OVERHEAD_SINCE(DISPATCH, t_dequeue);
+    TRACE(DISPATCH, t->get_task_id(), 0);
     
-    usleep(RR_TIMESLICE_US);
-    kill(t->get_pid(), SIGSTOP);
+    slice_timer st(RR_TIMESLICE_US);
+    st.wait(t);
     
     struct rusage ru;
-    int rc, wstat;
-    if ((rc = wait4(t->get_pid(), &wstat, WUNTRACED, &ru)) < 0)
-        err(EXIT_FAILURE, "waitpid");
-    else if (rc == 0)
-        err(EXIT_FAILURE, "child state did not change");
+    int wstat = st.stop(t, &ru);
     
     t->set_rusage(&ru);
     if (WIFEXITED(wstat)) {
         t->set_state(task_state::FINISHED);
         t->set_t_completion(high_resolution_clock::now());
-        std::cout << *t << " exited\n";
+        TRACE(EXIT, t->get_task_id(), 0);
+        LOG(INFO, EXITED, t, 0);
+        aggregator::retire(t);
     } else if (WIFSTOPPED(wstat) && WSTOPSIG(wstat) == SIGSTOP) {
         t->set_state(task_state::STOPPED);
         t->set_t_laststop(high_resolution_clock::now());
+        TRACE(PREEMPT, t->get_task_id(), 0);
         enqueue(t);
     }
 }
 
+/*
+ *  Idle workers park on the counting semaphore, which holds one count per
+ *  queued task plus one per worker once the scheduler is stopping. A count
+ *  may be taken before the matching ring cell is published, so a failed
+ *  pop only means "no work" when the ring has no outstanding tickets.
+ */
 rr::rr(u32 ncpus) noexcept
-    : sem(1), flag(0)
+    : sem(0), flag(0)
 {
     threads.reserve(ncpus);
     for (u32 cpuid = 0; cpuid < ncpus; ++cpuid) {
         threads.emplace_back([this]{
             while (true) {
                 task *t = nullptr;
+                OVERHEAD_START(t_idle);
                 sem.acquire();
-                if (tasks.empty()) {
-                    sem.release();
-                    if (RR_STOP(flag))
+                OVERHEAD_SINCE(SEM_WAIT, t_idle);
+                while (!tasks.try_pop(t)) {
+                    if (tasks.empty() && RR_STOP(flag.load()))
                         return;
-                    continue;
+                    std::this_thread::yield();
                 }
-                t = tasks.front();
-                tasks.pop();
-                sem.release();
                 schedule(t);
             }
         });
@@ -85,7 +96,8 @@ rr::rr(u32 ncpus) noexcept
 
 rr::~rr() noexcept
 {
-    flag = RR_STOP_FLAG;
+    flag.fetch_or(RR_STOP_FLAG);
+    sem.release(threads.size());
     for (std::thread &th : threads) {
         assert(th.joinable());
         th.join();
@@ -95,8 +107,8 @@ rr::~rr() noexcept
 void
 rr::enqueue(task *t) noexcept
 {
-    sem.acquire();
-    tasks.push(t);
+    while (!tasks.try_push(t))
+        std::this_thread::yield();
     sem.release();
 }
 } // namespace scheduler
@@ -1,4 +1,5 @@
 #include <iostream>
+#include <algorithm>
 #include <sys/sysinfo.h>
 #include <unistd.h>
 #include <cstdlib>
@@ -6,12 +7,38 @@
 #include "../include/task.hpp"
 #include "../include/rr.hpp"
 #include "../include/mlfq.hpp"
+#include "../include/pmlfq.hpp"
+#include "../include/reactor.hpp"
+#include "../include/cfs.hpp"
+#include "../include/eevdf.hpp"
+#include "../include/stride.hpp"
+#include "../include/srtf.hpp"
+#include "../include/edf.hpp"
 #include "../include/random.hpp"
 #include "../include/metrics.hpp"
+#include "../include/aggregator.hpp"
+#include "../include/trace.hpp"
+#include "../include/logger.hpp"
 #include "../include/scheduler.hpp"
+#include "../include/timer.hpp"
+#include "../include/launcher.hpp"
+#include "../include/procpool.hpp"
+#include "../include/des.hpp"
 
-#define S_RR    0x01 // use round robin scheduler
-#define S_MLFQ  0x02 // use multi-level feedback queue
+#define S_RR      0x01  // use round robin scheduler
+#define S_MLFQ    0x02  // use multi-level feedback queue
+#define S_PMLFQ   0x04  // use per-cpu multi-level feedback queue
+#define S_REACT   0x08  // use event driven round robin engine
+#define S_CFS     0x10  // use completely fair scheduler
+#define S_EEVDF   0x20  // use earliest eligible virtual deadline first
+#define S_STRIDE  0x40  // use stride proportional share scheduler
+#define S_LOTTERY 0x80  // use lottery proportional share scheduler
+#define S_SRTF    0x100 // use shortest remaining time first
+#define S_EDF     0x200 // use earliest deadline first
+#define S_MLFQ64  0x400 // use 64 level multi-level feedback queue
+#define S_MLFQ140 0x800 // use 140 level multi-level feedback queue
+#define S_PMLFQ64 0x1000 // use 64 level per-cpu multi-level feedback queue
+#define S_PMLFQ140 0x2000 // use 140 level per-cpu multi-level feedback queue
 
 void 
 print_usage()
@@ -21,9 +48,55 @@ print_usage()
               << "\t-s=SCHEDULER\tSee section on scheduler options\n\n"
               << "Tunable Parameters:\n"
               << "\t-r R\tRun the simulation for R s\n"
+              << "\t-i I\tPrint interval metrics every I s (0 disables, "
+              << "default 1)\n"
+              << "\t-v=V\tLog verbosity V (off, info or debug, default "
+              << "info)\n"
+              << "\t-t F\tWrite a Chrome trace of scheduler events to F "
+              << "(rr, mlfq*, pmlfq*; build with make TRACE=1)\n"
+              << "\t-p P\tBusy wait the last P us of every slice for "
+              << "precise preemption\n"
+              << "\t-l=L\tLaunch task processes with L (fork, spawn, vfork "
+              << "or zygote)\n"
+              << "\t-P N\tKeep N pre-exec'd stopped processes per task "
+              << "type\n"
+              << "\t-w W\tRun W tasks at once on every reactor loop "
+              << "(reactor, default 1)\n"
+              << "\t-N N\tNice N (-20..19) of memory bound tasks (cfs)\n"
+              << "\t-L N\tLatency nice N (-20..19) of memory bound tasks "
+              << "(eevdf)\n"
+              << "\t-T C:M\tFund the cpu and memory bound ticket groups "
+              << "with C and M tickets (stride, lottery)\n"
+              << "\t-X N@S\tMove N tickets from the cpu to the memory bound "
+              << "group after S s, back if N < 0 (stride, lottery)\n\n"
+              << "Virtual Time Mode:\n"
+              << "\t-m=des\tDiscrete-event simulation instead of real "
+              << "processes (rr, mlfq*, stride, lottery, srtf)\n"
+              << "\t-n N\tSimulate N tasks (default 100000)\n"
+              << "\t-c C\tSimulate C virtual cpus (default 64)\n"
               << "\nScheduler Options:\n"
               << "\t* mlfq\t\tMulti-Level Feedback Queue Scheduler\n"
-              << "\t* rr\t\tRound Robin Scheduler\n\n";
+              << "\t* mlfq64\t64 Level Feedback Queue (5 ms quantum steps)\n"
+              << "\t* mlfq140\t140 Level Feedback Queue (2 ms quantum steps)\n"
+              << "\t* pmlfq\t\tPer-CPU Multi-Level Feedback Queue Scheduler "
+              << "with Work Stealing\n"
+              << "\t* pmlfq64\t64 Level Per-CPU Feedback Queue (5 ms quantum "
+              << "steps)\n"
+              << "\t* pmlfq140\t140 Level Per-CPU Feedback Queue (2 ms "
+              << "quantum steps)\n"
+              << "\t* rr\t\tRound Robin Scheduler\n"
+              << "\t* reactor\tEvent Driven (pidfd + epoll) Round Robin "
+              << "Engine\n"
+              << "\t* cfs\t\tCompletely Fair Scheduler (vruntime "
+              << "red-black tree)\n"
+              << "\t* eevdf\t\tEarliest Eligible Virtual Deadline First "
+              << "Scheduler\n"
+              << "\t* stride\tStride Proportional Share Scheduler\n"
+              << "\t* lottery\tLottery Proportional Share Scheduler\n"
+              << "\t* srtf\t\tShortest Remaining Time First with Runtime "
+              << "Prediction\n"
+              << "\t* edf\t\tEarliest Deadline First Real-Time Scheduler "
+              << "with Admission Control\n\n";
 }
 
 int 
@@ -34,20 +107,143 @@ main(int argc, char *argv[])
         _exit(EXIT_FAILURE);
     }
 
-    u8 opt = 0x00;
+    u16 opt = 0x00;
     u32 runtime = 15;
+    launch_method launch = launch_method::FORK;
+    u32 poolsize = 0;
+    u32 width = 1;
+    i32 memnice = 0;
+    i32 latnice = 0;
+    log_level verbosity = log_level::INFO;
+    u64 cpu_tickets = STRIDE_GROUP_TICKETS;
+    u64 mem_tickets = STRIDE_GROUP_TICKETS;
+    i64 xfer_tickets = 0;
+    u32 xfer_after = 0;
+    bool virt = false;
+    u64 ntasks = 100000;
+    u32 nvcpus = 64;
 
     for (int i = 1; i < argc; ++i) {
         if (!strncmp(argv[i], "-s=rr", 5))
             opt |= S_RR;
+        else if (!strcmp(argv[i], "-s=mlfq64"))
+            opt |= S_MLFQ64;
+        else if (!strcmp(argv[i], "-s=mlfq140"))
+            opt |= S_MLFQ140;
         else if (!strncmp(argv[i], "-s=mlfq", 7))
             opt |= S_MLFQ;
+        else if (!strcmp(argv[i], "-s=pmlfq64"))
+            opt |= S_PMLFQ64;
+        else if (!strcmp(argv[i], "-s=pmlfq140"))
+            opt |= S_PMLFQ140;
+        else if (!strncmp(argv[i], "-s=pmlfq", 8))
+            opt |= S_PMLFQ;
+        else if (!strncmp(argv[i], "-s=reactor", 10))
+            opt |= S_REACT;
+        else if (!strncmp(argv[i], "-s=cfs", 6))
+            opt |= S_CFS;
+        else if (!strncmp(argv[i], "-s=eevdf", 8))
+            opt |= S_EEVDF;
+        else if (!strncmp(argv[i], "-s=stride", 9))
+            opt |= S_STRIDE;
+        else if (!strncmp(argv[i], "-s=lottery", 10))
+            opt |= S_LOTTERY;
+        else if (!strncmp(argv[i], "-s=srtf", 7))
+            opt |= S_SRTF;
+        else if (!strncmp(argv[i], "-s=edf", 6))
+            opt |= S_EDF;
         else if (!strncmp(argv[i], "-r", 2)) {
             if (i + 1 == argc)
                 std::cerr << "A runtime value must be provided after -r\n";
             else
                 runtime = strtoul(argv[i + 1], nullptr, 10);
             i++;
+        } else if (!strncmp(argv[i], "-i", 2)) {
+            if (i + 1 == argc)
+                std::cerr << "An interval must be provided after -i\n";
+            else
+                aggregator::set_interval(strtoul(argv[i + 1], nullptr, 10));
+            i++;
+        } else if (!strncmp(argv[i], "-t", 2)) {
+            if (i + 1 == argc)
+                std::cerr << "A trace file must be provided after -t\n";
+            else
+                trace::set_path(argv[i + 1]);
+#ifndef SCHEDSIM_TRACE
+            std::cerr << "Built without tracing, -t has no effect "
+                      << "(rebuild with make TRACE=1)\n";
+#endif
+            i++;
+        } else if (!strncmp(argv[i], "-v=off", 6))
+            verbosity = log_level::OFF;
+        else if (!strncmp(argv[i], "-v=info", 7))
+            verbosity = log_level::INFO;
+        else if (!strncmp(argv[i], "-v=debug", 8))
+            verbosity = log_level::DEBUG;
+        else if (!strncmp(argv[i], "-l=fork", 7))
+            launch = launch_method::FORK;
+        else if (!strncmp(argv[i], "-l=spawn", 8))
+            launch = launch_method::SPAWN;
+        else if (!strncmp(argv[i], "-l=vfork", 8))
+            launch = launch_method::VFORK;
+        else if (!strncmp(argv[i], "-l=zygote", 9))
+            launch = launch_method::ZYGOTE;
+        else if (!strncmp(argv[i], "-P", 2)) {
+            if (i + 1 == argc)
+                std::cerr << "A pool size must be provided after -P\n";
+            else
+                poolsize = strtoul(argv[i + 1], nullptr, 10);
+            i++;
+        } else if (!strncmp(argv[i], "-w", 2)) {
+            if (i + 1 == argc)
+                std::cerr << "A loop width must be provided after -w\n";
+            else
+                width = std::max(1UL, strtoul(argv[i + 1], nullptr, 10));
+            i++;
+        } else if (!strncmp(argv[i], "-N", 2)) {
+            if (i + 1 == argc)
+                std::cerr << "A nice level must be provided after -N\n";
+            else
+                memnice = strtol(argv[i + 1], nullptr, 10);
+            i++;
+        } else if (!strncmp(argv[i], "-L", 2)) {
+            if (i + 1 == argc)
+                std::cerr << "A latency nice must be provided after -L\n";
+            else
+                latnice = strtol(argv[i + 1], nullptr, 10);
+            i++;
+        } else if (!strncmp(argv[i], "-T", 2)) {
+            if (i + 1 == argc ||
+                sscanf(argv[i + 1], "%lu:%lu", &cpu_tickets, &mem_tickets) != 2)
+                std::cerr << "Group tickets C:M must be provided after -T\n";
+            i++;
+        } else if (!strncmp(argv[i], "-X", 2)) {
+            if (i + 1 == argc ||
+                sscanf(argv[i + 1], "%ld@%u", &xfer_tickets, &xfer_after) != 2)
+                std::cerr << "A transfer N@S must be provided after -X\n";
+            i++;
+        } else if (!strncmp(argv[i], "-p", 2)) {
+            if (i + 1 == argc)
+                std::cerr << "A spin time must be provided after -p\n";
+            else
+                slice_timer::set_spin(strtoul(argv[i + 1], nullptr, 10));
+            i++;
+        } else if (!strncmp(argv[i], "-m=des", 6))
+            virt = true;
+        else if (!strncmp(argv[i], "-m=real", 7))
+            virt = false;
+        else if (!strncmp(argv[i], "-n", 2)) {
+            if (i + 1 == argc)
+                std::cerr << "A task count must be provided after -n\n";
+            else
+                ntasks = strtoull(argv[i + 1], nullptr, 10);
+            i++;
+        } else if (!strncmp(argv[i], "-c", 2)) {
+            if (i + 1 == argc)
+                std::cerr << "A cpu count must be provided after -c\n";
+            else
+                nvcpus = strtoul(argv[i + 1], nullptr, 10);
+            i++;
         } else
             std::cerr << "Unrecognized Argument: " << argv[i] << '\n';
     }
@@ -56,11 +252,65 @@ main(int argc, char *argv[])
         std::cerr << "No scheduler was selected. Exiting...\n";
         _exit(EXIT_FAILURE);
     }
+
+    if (virt) {
+        if (opt & S_RR)
+            des::run<des::rr_policy>(ntasks, nvcpus);
+        else if (opt & S_MLFQ)
+            des::run<des::mlfq_policy>(ntasks, nvcpus);
+        else if (opt & S_MLFQ64)
+            des::run<des::mlfq64_policy>(ntasks, nvcpus);
+        else if (opt & S_MLFQ140)
+            des::run<des::mlfq140_policy>(ntasks, nvcpus);
+        else if (opt & S_STRIDE)
+            des::run<des::stride_policy>(ntasks, nvcpus);
+        else if (opt & S_LOTTERY)
+            des::run<des::lottery_policy>(ntasks, nvcpus);
+        else if (opt & S_SRTF)
+            des::run<des::srtf_policy>(ntasks, nvcpus);
+        else
+            std::cerr << "Scheduler not supported in virtual time mode\n";
+        std::cout.flush();
+        _exit(EXIT_SUCCESS);
+    }
+
+    /* before any scheduler thread exists, the zygote is forked here */
+    launcher::init(launch);
+    procpool::init(poolsize, { CPU_TASK_PATH, MEM_TASK_PATH });
+    logger::init(verbosity);
     
     if (opt & S_RR)
         scheduler::run<scheduler::rr>(runtime);
     else if (opt & S_MLFQ)
         scheduler::run<scheduler::mlfq>(runtime);
-    
+    else if (opt & S_MLFQ64)
+        scheduler::run<scheduler::mlfq64>(runtime);
+    else if (opt & S_MLFQ140)
+        scheduler::run<scheduler::mlfq140>(runtime);
+    else if (opt & S_PMLFQ64)
+        scheduler::run<scheduler::pmlfq64>(runtime);
+    else if (opt & S_PMLFQ140)
+        scheduler::run<scheduler::pmlfq140>(runtime);
+    else if (opt & S_PMLFQ)
+        scheduler::run<scheduler::pmlfq>(runtime);
+    else if (opt & S_REACT)
+        scheduler::run<scheduler::reactor>(runtime, (u32)get_nprocs(), width);
+    else if (opt & S_CFS)
+        scheduler::run<scheduler::cfs>(runtime, (u32)get_nprocs(), memnice);
+    else if (opt & S_EEVDF)
+        scheduler::run<scheduler::eevdf>(runtime, (u32)get_nprocs(), latnice);
+    else if (opt & (S_STRIDE | S_LOTTERY))
+        scheduler::run<scheduler::stride>(runtime, (u32)get_nprocs(),
+                                          (opt & S_LOTTERY) != 0,
+                                          cpu_tickets, mem_tickets,
+                                          xfer_tickets, xfer_after);
+    else if (opt & S_SRTF)
+        scheduler::run<scheduler::srtf>(runtime);
+    else if (opt & S_EDF)
+        scheduler::run<scheduler::edf>(runtime);
+
+    logger::shutdown();
+    procpool::shutdown();
+    std::cout.flush();
     _exit(EXIT_SUCCESS);
 }
@@ -0,0 +1,199 @@
+/* srtf.cpp Shortest Remaining Time First Scheduler */
+#include <iostream>
+#include <algorithm>
+#include <array>
+#include <queue>
+#include <vector>
+#include <thread>
+#include <pthread.h>
+#include <semaphore.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <signal.h>
+#include <err.h>
+#include "../include/types.hpp"
+#include "../include/task.hpp"
+#include "../include/aggregator.hpp"
+#include "../include/logger.hpp"
+#include "../include/overhead.hpp"
+#include "../include/histogram.hpp"
+#include "../include/timer.hpp"
+#include "../include/srtf.hpp"
+
+histogram runtime_predictor::error;
+
+runtime_predictor::runtime_predictor() noexcept
+    : pred{ SRTF_INIT_PRED_US, SRTF_INIT_PRED_US },
+      seeded{ false, false }
+{}
+
+u64
+runtime_predictor::total(task_kind kind) const noexcept
+{
+    return pred[(u32)kind];
+}
+
+/*
+ *  Estimated demand left after used us. A task that outlived its estimate
+ *  is assumed to need one more quantum, which keeps it ahead of tasks that
+ *  have not started yet rather than letting it fall behind all of them
+ */
+u64
+runtime_predictor::remaining(task_kind kind, u64 used) const noexcept
+{
+    u64 p = pred[(u32)kind];
+    return p > used + SRTF_QUANTUM_US ? p - used : SRTF_QUANTUM_US;
+}
+
+/* fold a finished task's demand into its class and score the estimate */
+void
+runtime_predictor::observe(task_kind kind, u64 predicted, u64 actual)
+noexcept
+{
+    u64 &p = pred[(u32)kind];
+    if (!seeded[(u32)kind]) {
+        p = actual;
+        seeded[(u32)kind] = true;
+    } else {
+        p = p - (p >> SRTF_EWMA_SHIFT) + (actual >> SRTF_EWMA_SHIFT);
+    }
+    if (actual)
+        error.record((predicted > actual ? predicted - actual
+                                         : actual - predicted) * 1000 / actual);
+}
+
+namespace scheduler {
+/* cpu time in us the task has received, as of its last stop */
+u64
+srtf::used(const task *t) noexcept
+{
+    return duration_cast<microseconds>(t->get_t_cpu()).count();
+}
+
+/* heap order: the task with the most cpu time is on top */
+bool
+srtf::less_used(task *a, task *b) noexcept
+{
+    return used(a) < used(b);
+}
+
+/* caller holds mtx */
+task *
+srtf::pick() noexcept
+{
+    ready_queue &cpu = ready[(u32)task_kind::CPU];
+    ready_queue &mem = ready[(u32)task_kind::MEM];
+    ready_queue *q;
+    if (cpu.empty() && mem.empty())
+        return nullptr;
+    if (cpu.empty())
+        q = &mem;
+    else if (mem.empty())
+        q = &cpu;
+    else
+        q = pred.remaining(task_kind::CPU, used(cpu.top())) <
+            pred.remaining(task_kind::MEM, used(mem.top())) ? &cpu : &mem;
+    task *t = q->top();
+    q->pop();
+    return t;
+}
+
+void
+srtf::schedule(task *t) noexcept
+{
+    struct rusage cur;
+
+    OVERHEAD_START(t_dequeue);
+    switch (t->get_state()) {
+    case task_state::RUNNABLE:
+        t->set_t_firstrun(high_resolution_clock::now());
+        t->run();
+        LOG(INFO, STARTED, t, 0);
+        break;
+    case task_state::STOPPED:
+        t->increment_t_waiting(high_resolution_clock::now());
+        kill(t->get_pid(), SIGCONT);
+        break;
+    default:
+        err(EXIT_FAILURE, "unexpected task state");
+    }
+    t->set_state(task_state::RUNNING);
+    OVERHEAD_SINCE(DISPATCH, t_dequeue);
+
+    slice_timer st(SRTF_QUANTUM_US);
+    st.wait(t);
+    int wstat = st.stop(t, &cur);
+    t->set_rusage(&cur);
+
+    if (WIFEXITED(wstat)) {
+        t->set_state(task_state::FINISHED);
+        t->set_t_completion(high_resolution_clock::now());
+        OVERHEAD_LOCK(&mtx);
+        pred.observe(t->get_kind(), predicted[t], used(t));
+        predicted.erase(t);
+        pthread_mutex_unlock(&mtx);
+
+        LOG(INFO, EXITED, t, 0);
+        aggregator::retire(t);
+    } else if (WIFSTOPPED(wstat) && WSTOPSIG(wstat) == SIGSTOP) {
+        t->set_state(task_state::STOPPED);
+        t->set_t_laststop(high_resolution_clock::now());
+        enqueue(t);
+    }
+}
+
+srtf::srtf(u32 ncpus) noexcept
+    : ready{ ready_queue(less_used), ready_queue(less_used) },
+      flag(0)
+{
+    pthread_mutex_init(&mtx, nullptr);
+    sem_init(&sem, 0, 0);
+    threads.reserve(ncpus);
+    for (u32 cpuid = 0; cpuid < ncpus; ++cpuid) {
+        threads.emplace_back([this]{
+            while (true) {
+                OVERHEAD_START(t_idle);
+                sem_wait(&sem);
+                OVERHEAD_SINCE(SEM_WAIT, t_idle);
+                OVERHEAD_LOCK(&mtx);
+                task *t = pick();
+                if (t && !predicted.count(t))
+                    predicted[t] = pred.total(t->get_kind());
+                pthread_mutex_unlock(&mtx);
+                if (t)
+                    schedule(t);
+                else if (SRTF_STOP(flag.load()))
+                    return;
+            }
+        });
+    }
+}
+
+srtf::~srtf() noexcept
+{
+    flag.fetch_or(SRTF_STOP_FLAG);
+    for (size_t i = 0; i < threads.size(); ++i)
+        sem_post(&sem);
+    for (std::thread &th : threads)
+        th.join();
+
+    std::cout << "\nRuntime Estimates:\n"
+              << "\tCPU Bound Tasks:\t"
+              << pred.total(task_kind::CPU) / 1e3 << "ms\n"
+              << "\tMemory Bound Tasks:\t"
+              << pred.total(task_kind::MEM) / 1e3 << "ms\n";
+
+    sem_destroy(&sem);
+    pthread_mutex_destroy(&mtx);
+}
+
+void
+srtf::enqueue(task *t) noexcept
+{
+    OVERHEAD_LOCK(&mtx);
+    ready[(u32)t->get_kind()].push(t);
+    pthread_mutex_unlock(&mtx);
+    sem_post(&sem);
+}
+} // namespace scheduler
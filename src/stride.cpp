@@ -0,0 +1,512 @@
+/* stride.cpp Stride and Lottery Proportional Share Schedulers */
+#include <iostream>
+#include <algorithm>
+#include <initializer_list>
+#include <vector>
+#include <random>
+#include <thread>
+#include <cassert>
+#include <pthread.h>
+#include <semaphore.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <signal.h>
+#include <err.h>
+#include "../include/types.hpp"
+#include "../include/task.hpp"
+#include "../include/aggregator.hpp"
+#include "../include/logger.hpp"
+#include "../include/overhead.hpp"
+#include "../include/histogram.hpp"
+#include "../include/timer.hpp"
+#include "../include/stride.hpp"
+
+/* pass += amount / tickets, carrying the remainder */
+static void
+advance(u64 &pass, u64 &rem, u64 amount, u64 tickets) noexcept
+{
+    u64 num = amount + rem;
+    pass += num / tickets;
+    rem = num % tickets;
+}
+
+ticket_tree::ticket_tree() noexcept
+    : total(0)
+{}
+
+void
+ticket_tree::add(u32 slot, i64 delta) noexcept
+{
+    for (u32 i = slot + 1; i < sums.size(); i += i & -i)
+        sums[i] += delta;
+}
+
+/* double the slot count and rebuild the sums of the occupied slots */
+void
+ticket_tree::grow() noexcept
+{
+    u32 cap = slots.empty() ? 64 : slots.size() * 2;
+    for (u32 i = cap; i-- > slots.size(); )
+        free_slots.push_back(i);
+    slots.resize(cap, nullptr);
+    sums.assign(cap + 1, 0);
+    for (u32 i = 0; i < slots.size(); ++i)
+        if (slots[i])
+            add(i, slots[i]->tickets);
+}
+
+bool
+ticket_tree::empty() const noexcept
+{
+    return total == 0;
+}
+
+u64
+ticket_tree::get_total() const noexcept
+{
+    return total;
+}
+
+void
+ticket_tree::insert(stride_client *c) noexcept
+{
+    if (free_slots.empty())
+        grow();
+    c->pos = free_slots.back();
+    free_slots.pop_back();
+    slots[c->pos] = c;
+    add(c->pos, c->tickets);
+    total += c->tickets;
+}
+
+void
+ticket_tree::erase(stride_client *c) noexcept
+{
+    add(c->pos, -(i64)c->tickets);
+    total -= c->tickets;
+    slots[c->pos] = nullptr;
+    free_slots.push_back(c->pos);
+}
+
+/* descend the implicit tree, skipping every prefix that ends at or below r */
+stride_client *
+ticket_tree::find(u64 r) const noexcept
+{
+    u32 pos = 0, cap = slots.size();
+    for (u32 step = 1U << (31 - __builtin_clz(cap)); step; step >>= 1) {
+        if (pos + step <= cap && sums[pos + step] <= r) {
+            pos += step;
+            r -= sums[pos];
+        }
+    }
+    return slots[pos];
+}
+
+stride_queue::stride_queue(bool lottery, std::initializer_list<u64> funding)
+noexcept
+    : groups(funding.size()),
+      tickets(0),
+      vtime(0),
+      vrem(0),
+      nr_transfers(0),
+      lottery(lottery),
+      rng(std::random_device{}())
+{
+    u32 id = 0;
+    for (u64 f : funding) {
+        group &g = groups[id];
+        g.tickets = std::max<u64>(f, 1);
+        g.member_tickets = 0;
+        g.nr_active = g.nr_queued = 0;
+        g.pass = g.rem = g.vtime = g.vrem = 0;
+        g.gvt = g.gvt_rem = 0;
+        g.t_used = g.t_entitled = g.ent_rem = 0;
+        g.t_used_mark = g.t_entitled_mark = 0;
+        g.id = id++;
+        g.pos = 0;
+        g.queued = false;
+    }
+}
+
+bool
+stride_queue::empty() const noexcept
+{
+    for (const group &g : groups)
+        if (g.nr_queued)
+            return false;
+    return true;
+}
+
+const std::vector<stride_queue::group> &
+stride_queue::get_groups() const noexcept
+{
+    return groups;
+}
+
+void
+stride_queue::push(stride_client *c) noexcept
+{
+    group &g = groups[c->group];
+    if (lottery)
+        g.lottery.insert(c);
+    else
+        g.members.push(c);
+    g.nr_queued++;
+    if (!g.queued && !lottery) {
+        top.push(&g);
+        g.queued = true;
+    }
+}
+
+/*
+ *  Make c runnable. A client (re)joining starts no earlier than the pass
+ *  of its group's members, and a group becoming active no earlier than
+ *  the pass of the other groups, so nobody can bank service while idle
+ */
+void
+stride_queue::join(stride_client *c) noexcept
+{
+    assert(c->tickets > 0 && c->group < groups.size());
+    group &g = groups[c->group];
+    if (g.nr_active++ == 0) {
+        tickets += g.tickets;
+        if (g.pass < vtime) {
+            g.pass = vtime;
+            g.rem = 0;
+        }
+    }
+    g.member_tickets += c->tickets;
+    if (c->pass < g.vtime) {
+        c->pass = g.vtime;
+        c->rem = 0;
+    }
+    c->gvt_join = g.gvt;
+    c->active = true;
+    push(c);
+}
+
+/*
+ *  c (not queued) stops being runnable: settle its entitlement. done marks
+ *  the final leave, which records its achieved/entitled service ratio
+ */
+void
+stride_queue::leave(stride_client *c, bool done) noexcept
+{
+    group &g = groups[c->group];
+    c->t_entitled += c->tickets * (g.gvt - c->gvt_join) / STRIDE1;
+    c->active = false;
+    g.member_tickets -= c->tickets;
+    if (--g.nr_active == 0)
+        tickets -= g.tickets;
+    if (done && c->t_entitled)
+        share.record(c->t_used * 1000 / c->t_entitled);
+}
+
+void
+stride_queue::requeue(stride_client *c) noexcept
+{
+    push(c);
+}
+
+stride_client *
+stride_queue::pick() noexcept
+{
+    group *g = nullptr;
+    stride_client *c;
+    if (!lottery) {
+        if (top.empty())
+            return nullptr;
+        g = top.top();
+        c = g->members.pop();
+        if (g->members.empty()) {
+            top.pop();
+            g->queued = false;
+        }
+    } else {
+        u64 total = 0;
+        for (group &h : groups)
+            if (h.nr_queued)
+                total += h.tickets;
+        if (total == 0)
+            return nullptr;
+        u64 r = rng() % total;
+        for (group &h : groups) {
+            if (!h.nr_queued)
+                continue;
+            if (r < h.tickets) {
+                g = &h;
+                break;
+            }
+            r -= h.tickets;
+        }
+        c = g->lottery.find(rng() % g->lottery.get_total());
+        g->lottery.erase(c);
+    }
+    g->nr_queued--;
+    return c;
+}
+
+/*
+ *  Account used us of service to the running client c: advance the pass
+ *  of c, of its group and of the joining points, then advance every active
+ *  group's entitlement clock by its share of the service delivered
+ */
+void
+stride_queue::charge(stride_client *c, u64 used) noexcept
+{
+    group &g = groups[c->group];
+    c->t_used += used;
+    g.t_used += used;
+
+    advance(c->pass, c->rem, used * STRIDE1, c->tickets);
+    advance(g.vtime, g.vrem, used * STRIDE1, g.member_tickets);
+    advance(g.pass, g.rem, used * STRIDE1, g.tickets);
+    advance(vtime, vrem, used * STRIDE1, tickets);
+    if (g.queued)
+        top.update(&g);
+
+    for (group &h : groups) {
+        if (!h.nr_active)
+            continue;
+        advance(h.gvt, h.gvt_rem, used * h.tickets * STRIDE1,
+                tickets * h.member_tickets);
+        advance(h.t_entitled, h.ent_rem, used * h.tickets, tickets);
+    }
+}
+
+/*
+ *  Change g's funding. The pass g has left to run until it catches up
+ *  with the other groups scales with its stride, old / new tickets
+ */
+void
+stride_queue::rescale(group &g, u64 new_tickets) noexcept
+{
+    if (g.nr_active)
+        tickets = tickets - g.tickets + new_tickets;
+    if (g.pass > vtime)
+        g.pass = vtime + (g.pass - vtime) * g.tickets / new_tickets;
+    g.rem = g.rem * new_tickets / g.tickets;
+    g.tickets = new_tickets;
+    if (g.queued)
+        top.update(&g);
+}
+
+/*
+ *  Move amount tickets between groups; from keeps at least one ticket.
+ *  Service is marked so the report can show the shares since
+ */
+bool
+stride_queue::transfer(u32 from, u32 to, u64 amount) noexcept
+{
+    if (from == to || from >= groups.size() || to >= groups.size() ||
+        groups[from].tickets <= amount)
+        return false;
+    rescale(groups[from], groups[from].tickets - amount);
+    rescale(groups[to], groups[to].tickets + amount);
+    for (group &g : groups) {
+        g.t_used_mark = g.t_used;
+        g.t_entitled_mark = g.t_entitled;
+    }
+    nr_transfers++;
+    return true;
+}
+
+void
+stride_queue::report(std::ostream &os) const noexcept
+{
+    u64 t_used = 0, t_entitled = 0;
+    for (const group &g : groups) {
+        t_used += g.t_used;
+        t_entitled += g.t_entitled;
+    }
+    os << "Ticket Groups (" << (lottery ? "lottery" : "stride") << "):\n";
+    for (const group &g : groups) {
+        os << "\tGroup " << g.id << ":\t" << g.tickets << " tickets, "
+           << g.t_used / 1e3 << "ms used ("
+           << (t_used ? 100.0 * g.t_used / t_used : 0) << "%), "
+           << g.t_entitled / 1e3 << "ms entitled ("
+           << (t_entitled ? 100.0 * g.t_entitled / t_entitled : 0)
+           << "%)\n";
+    }
+    if (nr_transfers) {
+        u64 d_used = t_used, d_entitled = t_entitled;
+        for (const group &g : groups) {
+            d_used -= g.t_used_mark;
+            d_entitled -= g.t_entitled_mark;
+        }
+        os << "Since Last Ticket Transfer (" << nr_transfers << " total):\n";
+        for (const group &g : groups) {
+            u64 used = g.t_used - g.t_used_mark;
+            u64 entitled = g.t_entitled - g.t_entitled_mark;
+            os << "\tGroup " << g.id << ":\t" << used / 1e3 << "ms used ("
+               << (d_used ? 100.0 * used / d_used : 0) << "%), "
+               << entitled / 1e3 << "ms entitled ("
+               << (d_entitled ? 100.0 * entitled / d_entitled : 0)
+               << "%)\n";
+        }
+    }
+    if (share.count())
+        os << "Achieved/Entitled Service (p1/p50/p99/max):\t"
+           << share.percentile(1) / 1e3 << '/'
+           << share.percentile(50) / 1e3 << '/'
+           << share.percentile(99) / 1e3 << '/'
+           << share.max() / 1e3 << '\n';
+}
+
+namespace scheduler {
+void
+stride::schedule(task *t) noexcept
+{
+    stride_client *c = t->get_sc();
+    struct rusage cur;
+
+    OVERHEAD_START(t_dequeue);
+    switch (t->get_state()) {
+    case task_state::RUNNABLE:
+        t->set_t_firstrun(high_resolution_clock::now());
+        t->run();
+        LOG(INFO, STARTED, t, 0);
+        break;
+    case task_state::STOPPED:
+        t->increment_t_waiting(high_resolution_clock::now());
+        kill(t->get_pid(), SIGCONT);
+        break;
+    default:
+        err(EXIT_FAILURE, "unexpected task state");
+    }
+    t->set_state(task_state::RUNNING);
+    OVERHEAD_SINCE(DISPATCH, t_dequeue);
+
+    /* charge the cpu time the task used, not the wall clock of the slice */
+    nanoseconds c0 = t->get_t_cpu();
+    slice_timer st(STRIDE_QUANTUM_US);
+    st.wait(t);
+    int wstat = st.stop(t, &cur);
+    u64 used = duration_cast<microseconds>(t->get_t_cpu() - c0).count();
+    t->set_rusage(&cur);
+
+    if (WIFEXITED(wstat)) {
+        t->set_state(task_state::FINISHED);
+        t->set_t_completion(high_resolution_clock::now());
+        OVERHEAD_LOCK(&mtx);
+        queue.charge(c, used);
+        queue.leave(c, true);
+        shares[c->id].sc = *c;
+        seen[c->id] = nullptr;
+        pthread_mutex_unlock(&mtx);
+
+        LOG(INFO, EXITED, t, 0);
+        aggregator::retire(t);
+    } else if (WIFSTOPPED(wstat) && WSTOPSIG(wstat) == SIGSTOP) {
+        t->set_state(task_state::STOPPED);
+        t->set_t_laststop(high_resolution_clock::now());
+        OVERHEAD_LOCK(&mtx);
+        queue.charge(c, used);
+        queue.requeue(c);
+        pthread_mutex_unlock(&mtx);
+        sem_post(&sem);
+    }
+}
+
+/* carry out the pending transfer once due, on the first worker to see it */
+void
+stride::transfer_due() noexcept
+{
+    if (steady_clock::now() < t_xfer)
+        return;
+    i64 n = xfer.exchange(0);
+    if (n && !(n > 0 ? transfer(0, 1, n) : transfer(1, 0, -n)))
+        std::cerr << "Ticket transfer of " << n << " refused: the giving "
+                  << "group must keep at least one ticket\n";
+}
+
+/* group 0 holds the cpu bound tasks, group 1 the memory bound ones */
+stride::stride(u32 ncpus, bool lottery, u64 cpu_tickets, u64 mem_tickets,
+               i64 xfer_tickets, u32 xfer_after) noexcept
+    : queue(lottery, { cpu_tickets, mem_tickets }),
+      flag(0),
+      xfer(xfer_tickets),
+      t_xfer(steady_clock::now() + seconds(xfer_after))
+{
+    pthread_mutex_init(&mtx, nullptr);
+    sem_init(&sem, 0, 0);
+    threads.reserve(ncpus);
+    for (u32 cpuid = 0; cpuid < ncpus; ++cpuid) {
+        threads.emplace_back([this]{
+            while (true) {
+                OVERHEAD_START(t_idle);
+                sem_wait(&sem);
+                OVERHEAD_SINCE(SEM_WAIT, t_idle);
+                if (xfer.load(std::memory_order_relaxed))
+                    transfer_due();
+                OVERHEAD_LOCK(&mtx);
+                auto t0 = high_resolution_clock::now();
+                stride_client *c = queue.pick();
+                t_pick.record(duration_cast<nanoseconds>(
+                    high_resolution_clock::now() - t0
+                ).count());
+                task *t = c ? seen[c->id] : nullptr;
+                pthread_mutex_unlock(&mtx);
+                if (t)
+                    schedule(t);
+                else if (STRIDE_STOP(flag.load()))
+                    return;
+            }
+        });
+    }
+}
+
+/* join workers and report the achieved and entitled service of each task */
+stride::~stride() noexcept
+{
+    flag.fetch_or(STRIDE_STOP_FLAG);
+    for (size_t i = 0; i < threads.size(); ++i)
+        sem_post(&sem);
+    for (std::thread &th : threads)
+        th.join();
+
+    std::cout << "\nProportional Share:\n";
+    for (size_t id = 0; id < shares.size(); ++id) {
+        const stride_client *c = seen[id] ? seen[id]->get_sc()
+                                          : &shares[id].sc;
+        std::cout << "\t(Task " << shares[id].task_id << "):\tgroup "
+                  << c->group << ", "
+                  << c->tickets << " tickets, " << c->t_used / 1e3
+                  << "ms used, " << c->t_entitled / 1e3 << "ms entitled";
+        if (c->t_entitled)
+            std::cout << " (" << (double)c->t_used / c->t_entitled << "x)";
+        std::cout << '\n';
+    }
+    queue.report(std::cout);
+    std::cout << "Pick Overhead (p50/p99/max):\t\t"
+              << t_pick.percentile(50) << '/' << t_pick.percentile(99) << '/'
+              << t_pick.max() << "ns\n";
+
+    sem_destroy(&sem);
+    pthread_mutex_destroy(&mtx);
+}
+
+void
+stride::enqueue(task *t) noexcept
+{
+    stride_client *c = t->get_sc();
+    c->tickets = t->get_se()->weight;
+    OVERHEAD_LOCK(&mtx);
+    c->id = seen.size();
+    seen.push_back(t);
+    shares.push_back({ t->get_task_id(), {} });
+    queue.join(c);
+    pthread_mutex_unlock(&mtx);
+    sem_post(&sem);
+}
+
+bool
+stride::transfer(u32 from, u32 to, u64 amount) noexcept
+{
+    OVERHEAD_LOCK(&mtx);
+    bool ok = queue.transfer(from, to, amount);
+    pthread_mutex_unlock(&mtx);
+    return ok;
+}
+} // namespace scheduler
@@ -1,203 +1,408 @@
 #include <chrono>
 #include <cstdint>
 #include <algorithm>
+#include <cstdio>
+#include <cstring>
 #include <sys/types.h>
 #include <err.h>
+#include <fcntl.h>
 #include <unistd.h>
 #include <sys/resource.h>
 #include <sys/time.h>
+#include <sys/syscall.h>
 #include <cassert>
 #include "../include/types.hpp"
 #include "../include/random.hpp"
 #include "../include/task.hpp"
+#include "../include/procpool.hpp"
+#include "../include/cpuacct.hpp"
+#include "../include/tasktable.hpp"
+#include "../include/aggregator.hpp"
+#include "../include/overhead.hpp"
+#include "../include/perfctr.hpp"
+
+/*
+ *  Load weight of nice levels NICE_MIN..NICE_MAX, as in Linux: every nice
+ *  level is worth about 10% cpu time, so adjacent weights differ by ~1.25x
+ */
+static const u32 nice_to_weight[NICE_MAX - NICE_MIN + 1] = {
+    /* -20 */   88761,  71755,  56483,  46273,  36291,
+    /* -15 */   29154,  23254,  18705,  14949,  11916,
+    /* -10 */    9548,   7620,   6100,   4904,   3906,
+    /*  -5 */    3121,   2501,   1991,   1586,   1277,
+    /*   0 */    1024,    820,    655,    526,    423,
+    /*   5 */     335,    272,    215,    172,    137,
+    /*  10 */     110,     87,     70,     56,     45,
+    /*  15 */      36,     29,     23,     18,     15,
+};
 
 task_stat::task_stat() noexcept
     : t_start(high_resolution_clock::now()),
-      t_waiting(milliseconds(0))
+      t_waiting(0ns),
+      t_reclaimed(0ns),
+      t_cpu(0ns),
+      t_rqdelay(0ns),
+      t_cpu_mark(0ns),
+      win_epoch(0),
+      win_cpu(0)
 {}
 
-milliseconds
+nanoseconds
 task_stat::get_t_turnaround() const noexcept
 {
-    return duration_cast<milliseconds>(t_completion - t_start);
+    return duration_cast<nanoseconds>(t_completion - t_start);
 }
 
-milliseconds
+nanoseconds
 task_stat::get_t_response() const noexcept
 {
-    return duration_cast<milliseconds>(t_firstrun - t_start);
+    return duration_cast<nanoseconds>(t_firstrun - t_start);
 }
 
-milliseconds
+nanoseconds
 task_stat::get_t_waiting() const noexcept
 {
     return t_waiting + get_t_response();
 }
 
-task::task(u32 id) noexcept
-    : ru(new struct rusage()),
-      stat(new task_stat()),
-      pid(0),
+/* state and pid are set up in the task table slot, see task_table::create */
+task::task(u32 id, task_kind kind) noexcept
+    : ru(),
+      stat(),
+      pidfd(-1),
+      statfd(-1),
+      schedfd(-1),
       task_id(id),
-      state(task_state::RUNNABLE)
+      slot(TASK_NO_SLOT),
+      kind(kind)
 {
-    stat->t_start = high_resolution_clock::now();
+    se.owner = this;
+    se.vruntime = 0;
+    se.deadline = 0;
+    se.min_deadline = 0;
+    se.vlag = 0;
+    se.weight = NICE_0_WEIGHT;
+    se.nice = 0;
+    se.latency_nice = 0;
+    sc = {};
+    rt = {};
 }
 
 task::~task() noexcept
 {
-    delete ru;
-    delete stat;
+    if (pidfd >= 0)
+        close(pidfd);
+    if (statfd >= 0)
+        close(statfd);
+    if (schedfd >= 0)
+        close(schedfd);
+    perfctr::detach(&pc);
 }
 
+/*
+ *  The schedulers set the state from what wait4 and the pidfd report, so
+ *  runnable, stopped and finished tasks are answered without a syscall.
+ *  Only a running task can have changed state behind the scheduler's back
+ *  (sleeping, in disk wait, exited but not reaped); ask the kernel then
+ */
 task_state
 task::get_state() const noexcept
 {
-    if (state == task_state::RUNNABLE || state == task_state::FINISHED)
-        return state;
-    FILE *f;
-    char buf[64];
-    snprintf(buf, sizeof(buf), "/proc/%d/task/%d/status", pid, pid);
-    if ((f = fopen(buf, "r")) == nullptr)
-        err(EXIT_FAILURE, "fopen");
-
-    char *line = nullptr;
-    size_t sz = 0;
-    char state = 'I';
-    while (getline(&line, &sz, f) > 0)
-        if (!strncmp(line, "State:", strlen("State:")))
-            sscanf(line, "%*s %c", &state);
-    
-    free(line);
-    fclose(f);
-    return static_cast<task_state>(state);
+    task_state state = task_table::state(slot);
+    if (state == task_state::RUNNING) {
+        OVERHEAD_START(t0);
+        state = get_proc_state();
+        OVERHEAD_SINCE(GET_STATE, t0);
+    }
+    return state;
+}
+
+/*
+ *  State field of /proc/<pid>/stat, read with pread on an fd kept open for
+ *  the life of the task. The field follows the last ')', as the command
+ *  name may itself contain parentheses and spaces
+ */
+task_state
+task::get_proc_state() const noexcept
+{
+    pid_t pid = task_table::pid(slot);
+    assert(pid > 0);
+    if (statfd < 0) {
+        char path[32];
+        snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+        if ((statfd = open(path, O_RDONLY | O_CLOEXEC)) < 0)
+            err(EXIT_FAILURE, "open %s", path);
+    }
+
+    char buf[256];
+    ssize_t n = pread(statfd, buf, sizeof(buf) - 1, 0);
+    if (n <= 0)
+        err(EXIT_FAILURE, "pread /proc/%d/stat", pid);
+    buf[n] = '\0';
+    const char *p = strrchr(buf, ')');
+    if (!p || p[1] != ' ' || !p[2])
+        return task_state::INVALID;
+    return static_cast<task_state>(p[2]);
 }
 
 void
 task::set_state(task_state new_state) noexcept
 {
-    state = new_state;
+    task_table::state(slot) = new_state;
 }
 
 pid_t
 task::get_pid() const noexcept
 {
-    return pid;
+    return task_table::pid(slot);
+}
+
+u32
+task::get_task_id() const noexcept
+{
+    return task_id;
+}
+
+task_kind
+task::get_kind() const noexcept
+{
+    return kind;
+}
+
+u32
+task::get_slot() const noexcept
+{
+    return slot;
+}
+
+/*
+ *  Return a pidfd for the running task, opening it on first use. The pidfd
+ *  becomes readable once the child exits, so it can be polled alongside
+ *  timers instead of blocking in wait4
+ */
+int
+task::get_pidfd() noexcept
+{
+    pid_t pid = task_table::pid(slot);
+    assert(pid > 0);
+    if (pidfd < 0 && (pidfd = syscall(SYS_pidfd_open, pid, 0)) < 0)
+        err(EXIT_FAILURE, "pidfd_open");
+    return pidfd;
+}
+
+sched_entity *
+task::get_se() noexcept
+{
+    return &se;
+}
+
+stride_client *
+task::get_sc() noexcept
+{
+    return &sc;
+}
+
+rt_entity *
+task::get_rt() noexcept
+{
+    return &rt;
+}
+
+i32
+task::get_nice() const noexcept
+{
+    return se.nice;
+}
+
+void
+task::set_nice(i32 nice) noexcept
+{
+    se.nice = std::clamp(nice, NICE_MIN, NICE_MAX);
+    se.weight = nice_to_weight[se.nice - NICE_MIN];
+}
+
+i32
+task::get_latency_nice() const noexcept
+{
+    return se.latency_nice;
+}
+
+void
+task::set_latency_nice(i32 latency_nice) noexcept
+{
+    se.latency_nice = std::clamp(latency_nice, NICE_MIN, NICE_MAX);
 }
 
-struct rusage *
+const struct rusage *
 task::get_rusage() const noexcept
 {
-    return ru;
+    return &ru;
 }
 
 void
 task::set_rusage(struct rusage *new_ru) noexcept
 {
-    ru->ru_utime.tv_sec = new_ru->ru_utime.tv_sec;
-    ru->ru_utime.tv_usec = new_ru->ru_utime.tv_usec;
-    ru->ru_stime.tv_sec = new_ru->ru_stime.tv_sec;
-    ru->ru_stime.tv_usec = new_ru->ru_stime.tv_usec;
+    ru.ru_utime.tv_sec = new_ru->ru_utime.tv_sec;
+    ru.ru_utime.tv_usec = new_ru->ru_utime.tv_usec;
+    ru.ru_stime.tv_sec = new_ru->ru_stime.tv_sec;
+    ru.ru_stime.tv_usec = new_ru->ru_stime.tv_usec;
 }
 
 time_point<high_resolution_clock>
 task::get_t_start() const noexcept
 {
-    return stat->t_start;
+    return stat.t_start;
 }
 
-milliseconds
+nanoseconds
 task::get_t_turnaround() const noexcept
 {
-    assert(state == task_state::FINISHED);
-    return stat->get_t_turnaround();
+    assert(task_table::state(slot) == task_state::FINISHED);
+    return stat.get_t_turnaround();
 }
 
-milliseconds
+nanoseconds
 task::get_t_response() const noexcept
 {
-    assert(state != task_state::RUNNABLE);
-    return stat->get_t_response();
+    assert(task_table::state(slot) != task_state::RUNNABLE);
+    return stat.get_t_response();
 }
 
-milliseconds
+nanoseconds
 task::get_t_waiting() const noexcept
 {
-    assert(state != task_state::RUNNABLE);
-    return stat->get_t_waiting();
+    assert(task_table::state(slot) != task_state::RUNNABLE);
+    return stat.get_t_waiting();
+}
+
+nanoseconds
+task::get_t_reclaimed() const noexcept
+{
+    return stat.t_reclaimed;
+}
+
+nanoseconds
+task::get_t_cpu() const noexcept
+{
+    return stat.t_cpu;
+}
+
+nanoseconds
+task::get_t_rqdelay() const noexcept
+{
+    return stat.t_rqdelay;
+}
+
+/*
+ *  A stopped child is sampled in nanoseconds. An exited one has been
+ *  reaped, so its final cpu time comes from ru, which is only kept to
+ *  microseconds; it never moves the sampled time backwards
+ */
+void
+task::account(const struct rusage *ru) noexcept
+{
+    cpu_sample s;
+    nanoseconds prev = stat.t_cpu;
+    if (cpuacct::sample(task_table::pid(slot), &schedfd, &s)) {
+        stat.t_cpu = nanoseconds(s.t_cpu);
+        stat.t_rqdelay = nanoseconds(s.t_delay);
+    } else {
+        stat.t_cpu = std::max(stat.t_cpu,
+                              nanoseconds(cpuacct::rusage_ns(ru)));
+    }
+    perfctr::read(&pc);
+    if (stat.t_cpu > prev) {
+        cpuacct::t_accounted.fetch_add((stat.t_cpu - prev).count(),
+                                       std::memory_order_relaxed);
+        aggregator::charge(stat, stat.t_cpu - prev);
+    }
+}
+
+const perf_counters &
+task::get_perf() const noexcept
+{
+    return pc;
+}
+
+nanoseconds
+task::get_t_cpu_since_mark() const noexcept
+{
+    return stat.t_cpu - stat.t_cpu_mark;
+}
+
+void
+task::mark_t_cpu() noexcept
+{
+    stat.t_cpu_mark = stat.t_cpu;
 }
 
 void
 task::set_t_completion(time_point<high_resolution_clock> t_completion) 
 noexcept
 {
-    stat->t_completion = t_completion;
+    stat.t_completion = t_completion;
 }
 
 void
 task::set_t_firstrun(time_point<high_resolution_clock> t_firstrun)
 noexcept
 {
-    stat->t_firstrun = t_firstrun;
+    stat.t_firstrun = t_firstrun;
 }
 
 void
 task::set_t_laststop(time_point<high_resolution_clock> t_stop) 
 noexcept
 {
-    stat->t_laststop = t_stop;
+    stat.t_laststop = t_stop;
 }
 
 void
 task::increment_t_waiting(time_point<high_resolution_clock> t_start) 
 noexcept
 {
-    stat->t_waiting += duration_cast<milliseconds>(
-        t_start - stat->t_laststop
+    stat.t_waiting += duration_cast<nanoseconds>(
+        t_start - stat.t_laststop
     );
 }
 
+void
+task::increment_t_reclaimed(nanoseconds t_unused) noexcept
+{
+    stat.t_reclaimed += t_unused;
+}
+
 std::ostream &
 operator<<(std::ostream &os, const task &t)
 {
-    switch (t.state) {
+    switch (task_table::state(t.slot)) {
     case task_state::RUNNABLE:
         os << "(Task " << t.task_id << ')';
         break;
     default:
-        os << "(Task " << t.task_id << ", PID: " << t.pid << ')';
+        os << "(Task " << t.task_id << ", PID: "
+           << task_table::pid(t.slot) << ')';
         break;
     }
     return os;
 }
 
-cpu_task::cpu_task(u32 id) noexcept : task(id) {}
+cpu_task::cpu_task(u32 id) noexcept : task(id, task_kind::CPU) {}
 cpu_task::~cpu_task() noexcept {}
 
 void
 cpu_task::run() noexcept
 {
-    if ((pid = fork()) < 0)
-        err(EXIT_FAILURE, "fork");
-    else if (pid > 0)
-        return;
-    
-    if (execl("./bin/cpu_task", "./bin/cpu_task", nullptr) < 0)
-        err(EXIT_FAILURE, "execvp");
+    task_table::pid(slot) = procpool::launch(CPU_TASK_PATH);
+    perfctr::attach(&pc, task_table::pid(slot));
 }
 
-mem_task::mem_task(u32 id) noexcept : task(id) {}
+mem_task::mem_task(u32 id) noexcept : task(id, task_kind::MEM) {}
 mem_task::~mem_task() noexcept {}
 
 void
 mem_task::run() noexcept
 {
-    if ((pid = fork()) < 0)
-        err(EXIT_FAILURE, "fork");
-    else if (pid > 0)
-        return;
-
-    if (execl("./bin/mem_task", "./bin/mem_task", nullptr) < 0)
-        err(EXIT_FAILURE, "execvp");
+    task_table::pid(slot) = procpool::launch(MEM_TASK_PATH);
+    perfctr::attach(&pc, task_table::pid(slot));
 }
-
@@ -0,0 +1,98 @@
+/* tasktable.cpp Slab Allocated Task Table */
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <cassert>
+#include <err.h>
+#include "../include/types.hpp"
+#include "../include/task.hpp"
+#include "../include/tasktable.hpp"
+
+std::atomic<task_table::chunk *> task_table::chunks[TASK_MAX_CHUNKS];
+std::vector<u32> task_table::free_slots;
+u32 task_table::nr_slots = 0;
+u32 task_table::nr_live = 0;
+std::mutex task_table::mtx;
+
+task_table::chunk *
+task_table::chunk_of(u32 idx) noexcept
+{
+    assert(idx != TASK_NO_SLOT);
+    return chunks[idx >> TASK_CHUNK_BITS].load(std::memory_order_acquire);
+}
+
+/* take a free slot, growing the table by a chunk when none is left */
+u32
+task_table::alloc() noexcept
+{
+    std::lock_guard<std::mutex> lk(mtx);
+    u32 idx;
+    if (!free_slots.empty()) {
+        idx = free_slots.back();
+        free_slots.pop_back();
+    } else {
+        if (nr_slots == TASK_MAX_CHUNKS * TASK_CHUNK)
+            errx(EXIT_FAILURE, "task table full (%u tasks)", nr_slots);
+        idx = nr_slots++;
+        if (!(idx & (TASK_CHUNK - 1))) {
+            chunk *c = new (std::nothrow) chunk();
+            if (!c)
+                errx(EXIT_FAILURE, "task table: out of memory");
+            chunks[idx >> TASK_CHUNK_BITS].store(c,
+                                                 std::memory_order_release);
+        }
+    }
+    chunk *c = chunk_of(idx);
+    u32 i = idx & (TASK_CHUNK - 1);
+    c->state[i] = task_state::RUNNABLE;
+    c->pid[i] = 0;
+    nr_live++;
+    return idx;
+}
+
+void *
+task_table::storage(u32 idx) noexcept
+{
+    return chunk_of(idx)->objs[idx & (TASK_CHUNK - 1)].buf;
+}
+
+void
+task_table::bind(task *t, u32 idx) noexcept
+{
+    t->slot = idx;
+    chunk_of(idx)->tasks[idx & (TASK_CHUNK - 1)] = t;
+}
+
+void
+task_table::destroy(task *t) noexcept
+{
+    u32 idx = t->slot;
+    chunk *c = chunk_of(idx);
+    u32 i = idx & (TASK_CHUNK - 1);
+    assert(c->tasks[i] == t);
+    t->~task();
+
+    std::lock_guard<std::mutex> lk(mtx);
+    c->tasks[i] = nullptr;
+    nr_live--;
+    free_slots.push_back(idx);
+}
+
+task_state &
+task_table::state(u32 idx) noexcept
+{
+    return chunk_of(idx)->state[idx & (TASK_CHUNK - 1)];
+}
+
+pid_t &
+task_table::pid(u32 idx) noexcept
+{
+    return chunk_of(idx)->pid[idx & (TASK_CHUNK - 1)];
+}
+
+u32
+task_table::size() noexcept
+{
+    std::lock_guard<std::mutex> lk(mtx);
+    return nr_live;
+}
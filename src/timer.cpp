@@ -0,0 +1,138 @@
+#include <chrono>
+#include <algorithm>
+#include <sys/timerfd.h>
+#include <sys/wait.h>
+#include <sys/types.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <time.h>
+#include <err.h>
+#include <cerrno>
+#include "../include/types.hpp"
+#include "../include/task.hpp"
+#include "../include/histogram.hpp"
+#include "../include/latency.hpp"
+#include "../include/overhead.hpp"
+#include "../include/timer.hpp"
+
+u32 slice_timer::spin_us = 0;
+
+/* one timerfd per scheduler thread, closed when the thread exits */
+int
+slice_timer::tfd() noexcept
+{
+    struct fd_guard {
+        int fd;
+        fd_guard() noexcept
+            : fd(timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC))
+        {
+            if (fd < 0)
+                err(EXIT_FAILURE, "timerfd_create");
+        }
+        ~fd_guard() noexcept { close(fd); }
+    };
+    thread_local fd_guard g;
+    return g.fd;
+}
+
+slice_timer::slice_timer(u32 quantum_us, u32 level) noexcept
+    : t_begin(steady_clock::now()),
+      t_deadline(t_begin + microseconds(quantum_us)),
+      level(level),
+      exited(false)
+{}
+
+/*
+ *  Wait until the slice deadline or until the task exits, whichever comes
+ *  first. Returns true if the task exited early, in which case the unused
+ *  part of the slice is credited to the task as reclaimed time
+ */
+bool
+slice_timer::wait(task *t) noexcept
+{
+    int fd = tfd();
+    auto t_arm = t_deadline - microseconds(spin_us);
+    if (t_arm > steady_clock::now()) {
+        auto ns = duration_cast<nanoseconds>(t_arm.time_since_epoch());
+        struct itimerspec its = {};
+        its.it_value.tv_sec = ns.count() / 1000000000;
+        its.it_value.tv_nsec = ns.count() % 1000000000;
+        if (timerfd_settime(fd, TFD_TIMER_ABSTIME, &its, nullptr) < 0)
+            err(EXIT_FAILURE, "timerfd_settime");
+
+        struct pollfd pfds[2] = {
+            { fd, POLLIN, 0 },
+            { t->get_pidfd(), POLLIN, 0 }
+        };
+        int rc;
+        while ((rc = poll(pfds, 2, -1)) < 0 && errno == EINTR)
+            ;
+        if (rc < 0)
+            err(EXIT_FAILURE, "poll");
+
+        /* disarm (which also clears any expiration) before returning */
+        its = {};
+        timerfd_settime(fd, 0, &its, nullptr);
+        exited = pfds[1].revents & POLLIN;
+    }
+
+    /* spin phase: keep watching the pidfd so an exit still ends the slice */
+    if (!exited) {
+        struct pollfd pfd = { t->get_pidfd(), POLLIN, 0 };
+        while (steady_clock::now() < t_deadline) {
+            if (poll(&pfd, 1, 0) > 0) {
+                exited = true;
+                break;
+            }
+        }
+    }
+
+    if (exited)
+        reclaim(t, t_deadline);
+    return exited;
+}
+
+/*
+ *  Stop the task and collect its status with wait4, recording the stop
+ *  latency and, for slices that ran to their deadline, the overshoot
+ */
+int
+slice_timer::stop(task *t, struct rusage *ru) noexcept
+{
+    int wstat;
+    OVERHEAD_START(t_kill);
+    kill(t->get_pid(), SIGSTOP);
+    if (wait4(t->get_pid(), &wstat, WUNTRACED, ru) < 0)
+        err(EXIT_FAILURE, "wait4");
+    auto t_stopped = steady_clock::now();
+    t->account(ru);
+
+    if (WIFSTOPPED(wstat)) {
+        OVERHEAD_RECORD(STOP, duration_cast<nanoseconds>(
+            t_stopped - t_kill
+        ).count());
+        if (!exited) {
+            u64 ns = duration_cast<nanoseconds>(
+                std::max(t_stopped - t_deadline, steady_clock::duration(0))
+            ).count();
+            latency::record(lat_metric::OVERSHOOT, t->get_kind(), ns);
+            latency::record_level(level, ns);
+        }
+    }
+    return wstat;
+}
+
+/* credit t with what is left of its slice ending at t_deadline */
+void
+slice_timer::reclaim(task *t, time_point<steady_clock> t_deadline) noexcept
+{
+    if (auto t_left = t_deadline - steady_clock::now(); t_left > 0ns)
+        t->increment_t_reclaimed(duration_cast<nanoseconds>(t_left));
+}
+
+void
+slice_timer::set_spin(u32 us) noexcept
+{
+    spin_us = us;
+}
@@ -0,0 +1,128 @@
+/* trace.cpp Scheduler Event Trace and Chrome Trace Export */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <err.h>
+#include "../include/types.hpp"
+#include "../include/registry.hpp"
+#include "../include/trace.hpp"
+
+thread_registry<trace::ring>    trace::rings;
+const char                      *trace::path = nullptr;
+std::atomic<bool>               trace::on(false);
+
+void
+trace::emit(trace_type type, u32 task, u16 arg) noexcept
+{
+    if (!on.load(std::memory_order_relaxed))
+        return;
+    ring &r = rings.local();
+    u64 h = r.head.load(std::memory_order_relaxed);
+    r.buf[h & (TRACE_RING - 1)] = {
+        (u64)duration_cast<nanoseconds>(
+            steady_clock::now().time_since_epoch()
+        ).count(),
+        task, arg, type
+    };
+    r.head.store(h + 1, std::memory_order_release);
+}
+
+void
+trace::set_path(const char *p) noexcept
+{
+    path = p;
+    on.store(p != nullptr);
+}
+
+static const char *
+instant_name(trace_type type) noexcept
+{
+    switch (type) {
+    case trace_type::DEMOTE:
+        return "demote";
+    case trace_type::BOOST:
+        return "boost";
+    case trace_type::STEAL:
+        return "steal";
+    default:
+        return "event";
+    }
+}
+
+/*
+ *  Timestamps are microseconds from the earliest event kept. A dispatch is
+ *  closed by the next preempt or exit of the same ring; one left open
+ *  (a slice cut off by the end of the ring) is dropped
+ */
+void
+trace::dump() noexcept
+{
+    if (!path)
+        return;
+    on.store(false);
+    FILE *f = fopen(path, "w");
+    if (!f)
+        err(EXIT_FAILURE, "fopen %s", path);
+
+    u64 t0 = UINT64_MAX, lost = 0, nr_events = 0;
+    rings.for_each([&](const ring &r) {
+        u64 h = r.head.load(std::memory_order_acquire);
+        u64 first = h > TRACE_RING ? h - TRACE_RING : 0;
+        lost += first;
+        if (h > first)
+            t0 = std::min(t0, r.buf[first & (TRACE_RING - 1)].ts);
+    });
+
+    fprintf(f, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    bool comma = false;
+    auto sep = [&]{ fputs(comma ? ",\n" : "", f); comma = true; };
+    u32 id = 0;
+    rings.for_each([&](const ring &r) {
+        sep();
+        fprintf(f, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,"
+                   "\"tid\":%u,\"args\":{\"name\":\"worker %u\"}}",
+                id, id);
+
+        u64 h = r.head.load(std::memory_order_acquire);
+        u64 first = h > TRACE_RING ? h - TRACE_RING : 0;
+        const trace_event *open = nullptr;
+        for (u64 i = first; i < h; ++i) {
+            const trace_event &e = r.buf[i & (TRACE_RING - 1)];
+            double ts = (e.ts - t0) / 1e3;
+            nr_events++;
+            switch (e.type) {
+            case trace_type::DISPATCH:
+                open = &e;
+                break;
+            case trace_type::PREEMPT:
+            case trace_type::EXIT:
+                if (!open || open->task != e.task)
+                    break;
+                sep();
+                fprintf(f, "{\"name\":\"Task %u\",\"ph\":\"X\",\"pid\":0,"
+                           "\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,"
+                           "\"args\":{\"level\":%u,\"end\":\"%s\"}}",
+                        e.task, id, (open->ts - t0) / 1e3,
+                        (e.ts - open->ts) / 1e3, open->arg,
+                        e.type == trace_type::EXIT ? "exit" : "preempt");
+                open = nullptr;
+                break;
+            default:
+                sep();
+                fprintf(f, "{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\","
+                           "\"pid\":0,\"tid\":%u,\"ts\":%.3f,"
+                           "\"args\":{\"task\":%u,\"arg\":%u}}",
+                        instant_name(e.type), id, ts, e.task, e.arg);
+                break;
+            }
+        }
+        id++;
+    });
+    fprintf(f, "\n]}\n");
+    fclose(f);
+    fprintf(stderr, "trace: %" PRIu64 " events from %u threads written to "
+                    "%s (%" PRIu64 " overwritten)\n",
+            nr_events, id, path, lost);
+}